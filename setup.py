@@ -7,9 +7,20 @@ import subprocess
 from distutils.core import setup, Extension
 
 PCRE_VERSION = 8.30
+PCRE2_VERSION = 10.0
+
+# PCRE2 backend is selected by --with-pcre2 option, legacy pcre is the default
+use_pcre2 = '--with-pcre2' in sys.argv
+if use_pcre2:
+    sys.argv.remove('--with-pcre2')
+
+# USDT probes for perf, bpftrace and SystemTap are built by --with-usdt option, sys/sdt.h is required
+use_usdt = '--with-usdt' in sys.argv
+if use_usdt:
+    sys.argv.remove('--with-usdt')
 
 def get_pcre_info():
-    cmd = 'pcre-config --version --prefix'
+    cmd = '%s --version --prefix' % ('pcre2-config' if use_pcre2 else 'pcre-config')
     args = shlex.split(cmd)
     p = subprocess.Popen(cmd, shell=True, stdout=subprocess.PIPE)
     retcode = p.wait()
@@ -17,15 +28,27 @@ def get_pcre_info():
         # pcre-config wrote message to stderr
         exit(1)
     
-    version = p.stdout.readline()
-    prefix = p.stdout.readline()
+    version = p.stdout.readline().strip()
+    prefix = p.stdout.readline().strip()
     
     return (version, prefix)
 
 version, prefix = get_pcre_info()
 
-if float(version) < PCRE_VERSION:
-    print >>sys.stderr, 'pcre is required in version >=', PCRE_VERSION
+if use_pcre2:
+    required_version = PCRE2_VERSION
+    libraries = ['pcre2-8']
+    define_macros = [('USE_PCRE2', None)]
+else:
+    required_version = PCRE_VERSION
+    libraries = ['pcre']
+    define_macros = []
+
+if use_usdt:
+    define_macros.append(('USE_USDT', None))
+
+if float(version) < required_version:
+    print >>sys.stderr, '%s is required in version >=' % libraries[0], required_version
     exit(1)
 
 pcre_include_dir = os.path.join(prefix, 'include')
@@ -43,10 +66,13 @@ setup(name='python-pcre',
       package_dir={'': 'src'},
       ext_modules=[
         Extension('_pcre',
-            ['src/_pcre/pcre_match.c', 'src/_pcre/pcre_module.c',
-             'src/_pcre/pcre_regex.c'],
+            ['src/_pcre/pcre_index.c', 'src/_pcre/pcre_lexer.c', 'src/_pcre/pcre_match.c',
+             'src/_pcre/pcre_module.c', 'src/_pcre/pcre_regex.c',
+             'src/_pcre/pcre_state.c', 'src/_pcre/pcre_trace.c'],
             include_dirs=[pcre_include_dir],
             library_dirs=[pcre_library_dir],
-            libraries=['pcre'],
-            extra_compile_args=['-Wall', '-std=gnu99'])]
+            libraries=libraries,
+            define_macros=define_macros,
+            extra_compile_args=['-Wall', '-std=gnu99', '-pthread'],
+            extra_link_args=['-pthread'])]
 )
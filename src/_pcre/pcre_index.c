@@ -0,0 +1,414 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pcre_module.h"
+#include "pcre_regex.h"
+#include "pcre_index.h"
+
+/*
+ * Every pattern is reduced to the bytes a match of it can start with and the byte it
+ * requires, as libpcre itself uses them to skip a subject. The index keeps for each byte
+ * the set of patterns accepting it, so one pass over the subject and a few unions of
+ * these sets select the candidates before any pattern is run.
+ */
+
+#define INDEX_SET(set, i) ((set)[(i) / 64] |= (uint64_t)1 << ((i) % 64))
+#define INDEX_HAS(set, i) (((set)[(i) / 64] >> ((i) % 64)) & 1)
+#define INDEX_ROW(table, self, byte) ((table) + (size_t)(byte) * (self)->words)
+
+static void
+pcre_IndexObject_dealloc(pcre_IndexObject* self)
+{
+	free(self->first);
+	free(self->anchored);
+	free(self->required);
+	free(self->any_first);
+	free(self->any_required);
+	free(self->selected);
+	free(self->min_lengths);
+	free(self->ovector);
+
+	Py_XDECREF(self->patterns);
+
+	self->ob_type->tp_free((PyObject*)self);
+}
+
+// tables built by pcre_maketables() start by the lower case table and the case flipping one
+#define TABLES_FLIPCASE 256
+
+/*
+ * Adds the byte to the bitmap, with its other case as the pattern may be caseless
+ * (libpcre doesn't tell). The case is flipped by the locale tables of the pattern,
+ * or as in the default tables of libpcre, which are built for the C locale. Bytes
+ * over ASCII can have other cases by UTF, 0 is returned for them, as the bitmap
+ * can't be relied on.
+ */
+static int
+pcre_IndexObject_addbyte(pcre_RegexObject *regex, unsigned char *bitmap, unsigned int byte)
+{
+	if (byte >= 0x80)
+		return 0;
+
+	unsigned int other = byte;
+	if (regex->locale != NULL)
+		other = regex->locale->tables[TABLES_FLIPCASE + byte];
+	else if (byte >= 'a' && byte <= 'z')
+		other = byte - 'a' + 'A';
+	else if (byte >= 'A' && byte <= 'Z')
+		other = byte - 'A' + 'a';
+
+	bitmap[byte / 8] |= 1 << (byte % 8);
+	bitmap[other / 8] |= 1 << (other % 8);
+	return 1;
+}
+
+// fills bitmap of bytes every match starts with, returns 0 when they aren't known
+static int
+pcre_IndexObject_firstbytes(pcre_RegexObject *regex, unsigned char *bitmap)
+{
+#ifdef USE_PCRE2
+	uint32_t type = 0, unit;
+	const uint8_t *table = NULL;
+
+	if (pcre_RegexObject_fullinfo(regex, INFO_FIRSTCODETYPE, &type) == 0 && type == 1 &&
+			pcre_RegexObject_fullinfo(regex, INFO_FIRSTCODEUNIT, &unit) == 0)
+		return pcre_IndexObject_addbyte(regex, bitmap, unit);
+
+	// the start bitmap considers both cases itself
+	if (pcre_RegexObject_fullinfo(regex, INFO_FIRSTBITMAP, &table) == 0 && table != NULL) {
+		memcpy(bitmap, table, 32);
+		return 1;
+	}
+#else
+	int firstbyte;
+	const unsigned char *table = NULL;
+
+	if (pcre_RegexObject_fullinfo(regex, INFO_FIRSTBYTE, &firstbyte) == 0 && firstbyte >= 0)
+		return pcre_IndexObject_addbyte(regex, bitmap, firstbyte);
+
+	// only a studied pattern has the table
+	if (pcre_RegexObject_fullinfo(regex, INFO_FIRSTTABLE, &table) == 0 && table != NULL) {
+		memcpy(bitmap, table, 32);
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+// fills bitmap of the byte every match contains, returns 0 when there isn't one
+static int
+pcre_IndexObject_requiredbytes(pcre_RegexObject *regex, unsigned char *bitmap)
+{
+#ifdef USE_PCRE2
+	uint32_t type = 0, unit;
+
+	if (pcre_RegexObject_fullinfo(regex, INFO_LASTCODETYPE, &type) == 0 && type == 1 &&
+			pcre_RegexObject_fullinfo(regex, INFO_LASTCODEUNIT, &unit) == 0)
+		return pcre_IndexObject_addbyte(regex, bitmap, unit);
+#else
+	int lastliteral;
+
+	if (pcre_RegexObject_fullinfo(regex, INFO_LASTLITERAL, &lastliteral) == 0 && lastliteral >= 0)
+		return pcre_IndexObject_addbyte(regex, bitmap, lastliteral);
+#endif
+	return 0;
+}
+
+static int
+pcre_IndexObject_isanchored(pcre_RegexObject *regex)
+{
+#ifdef USE_PCRE2
+	uint32_t options = 0;
+	pcre_RegexObject_fullinfo(regex, INFO_ALLOPTIONS, &options);
+	return (options & PCRE2_ANCHORED) != 0;
+#else
+	unsigned long int options = 0;
+	pcre_RegexObject_fullinfo(regex, INFO_OPTIONS, &options);
+	return (options & PCRE_ANCHORED) != 0;
+#endif
+}
+
+static void
+pcre_IndexObject_addpattern(pcre_IndexObject *self, int i, pcre_RegexObject *regex)
+{
+	unsigned char bitmap[32];
+
+	memset(bitmap, 0, sizeof(bitmap));
+	if (pcre_IndexObject_firstbytes(regex, bitmap)) {
+		uint64_t *table = pcre_IndexObject_isanchored(regex) ? self->anchored : self->first;
+		for (int byte = 0; byte < 256; byte++) {
+			if (bitmap[byte / 8] & (1 << (byte % 8)))
+				INDEX_SET(INDEX_ROW(table, self, byte), i);
+		}
+	}
+	else
+		INDEX_SET(self->any_first, i);
+
+	memset(bitmap, 0, sizeof(bitmap));
+	if (pcre_IndexObject_requiredbytes(regex, bitmap)) {
+		for (int byte = 0; byte < 256; byte++) {
+			if (bitmap[byte / 8] & (1 << (byte % 8)))
+				INDEX_SET(INDEX_ROW(self->required, self, byte), i);
+		}
+	}
+	else
+		INDEX_SET(self->any_required, i);
+
+	// -1 when legacy pattern isn't studied
+	int min_length = 0;
+	pcre_RegexObject_fullinfo(regex, INFO_MINLENGTH, &min_length);
+	self->min_lengths[i] = (min_length > 0) ? min_length : 0;
+}
+
+static int
+pcre_IndexObject_init(pcre_IndexObject *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *patterns;
+
+	static char *kwlist[] = {"patterns", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &patterns))
+		return -1;
+
+	if (self->patterns != NULL) {
+		PyErr_SetString(PcreError, "PatternIndex is already initialized.");
+		return -1;
+	}
+
+	self->patterns = PySequence_Tuple(patterns);
+	if (self->patterns == NULL)
+		return -1;
+
+	self->count = (int)PyTuple_GET_SIZE(self->patterns);
+	self->words = (self->count + 63) / 64;
+
+	int groups = 0;
+	for (int i = 0; i < self->count; i++) {
+		PyObject *regex = PyTuple_GET_ITEM(self->patterns, i);
+		if (!PyObject_TypeCheck(regex, &pcre_RegexType)) {
+			PyErr_SetString(PyExc_TypeError, "PatternIndex needs a sequence of RegexObjects.");
+			return -1;
+		}
+		if (((pcre_RegexObject *)regex)->groups > groups)
+			groups = ((pcre_RegexObject *)regex)->groups;
+	}
+
+	// calloc() of zero items may return NULL, a word more is allocated
+	size_t words = self->words + 1;
+	self->first = (uint64_t *)calloc(256 * words, sizeof(uint64_t));
+	self->anchored = (uint64_t *)calloc(256 * words, sizeof(uint64_t));
+	self->required = (uint64_t *)calloc(256 * words, sizeof(uint64_t));
+	self->any_first = (uint64_t *)calloc(words, sizeof(uint64_t));
+	self->any_required = (uint64_t *)calloc(words, sizeof(uint64_t));
+	self->selected = (uint64_t *)calloc(words, sizeof(uint64_t));
+	self->min_lengths = (int *)calloc(self->count + 1, sizeof(int));
+	self->ovector = (int *)malloc((groups + 1) * 3 * sizeof(int));
+	if (self->first == NULL || self->anchored == NULL || self->required == NULL || self->any_first == NULL ||
+			self->any_required == NULL || self->selected == NULL || self->min_lengths == NULL ||
+			self->ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the pattern index.");
+		return -1;
+	}
+
+	for (int i = 0; i < self->count; i++)
+		pcre_IndexObject_addpattern(self, i, (pcre_RegexObject *)PyTuple_GET_ITEM(self->patterns, i));
+
+	return 0;
+}
+
+// fills selected by patterns which can match subject[pos:length]
+static void
+pcre_IndexObject_select(pcre_IndexObject *self, const unsigned char *subject, int length, int pos)
+{
+	int words = self->words;
+	uint64_t present[4] = {0, 0, 0, 0};
+	uint64_t starts[words + 1], requires[words + 1];
+
+	for (int i = pos; i < length; i++)
+		present[subject[i] / 64] |= (uint64_t)1 << (subject[i] % 64);
+
+	memcpy(starts, self->any_first, words * sizeof(uint64_t));
+	memcpy(requires, self->any_required, words * sizeof(uint64_t));
+
+	// an anchored pattern can start only at pos
+	if (pos < length) {
+		uint64_t *row = INDEX_ROW(self->anchored, self, subject[pos]);
+		for (int w = 0; w < words; w++)
+			starts[w] |= row[w];
+	}
+
+	for (int byte = 0; byte < 256; byte++) {
+		if (!INDEX_HAS(present, byte))
+			continue;
+
+		uint64_t *first = INDEX_ROW(self->first, self, byte);
+		uint64_t *required = INDEX_ROW(self->required, self, byte);
+		for (int w = 0; w < words; w++) {
+			starts[w] |= first[w];
+			requires[w] |= required[w];
+		}
+	}
+
+	for (int w = 0; w < words; w++)
+		self->selected[w] = starts[w] & requires[w];
+
+	for (int i = 0; i < self->count; i++) {
+		if (INDEX_HAS(self->selected, i) && length - pos < self->min_lengths[i])
+			self->selected[i / 64] &= ~((uint64_t)1 << (i % 64));
+	}
+}
+
+static PyObject *
+pcre_IndexObject_lookup(pcre_IndexObject *self, PyObject *args, PyObject *keywds, int run)
+{
+	char *subject;
+	int length, pos = 0;
+
+	static char *kwlist[] = {"string", "pos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|i", kwlist, &subject, &length, &pos))
+		return NULL;
+
+	if (self->patterns == NULL) {
+		PyErr_SetString(PcreError, "PatternIndex is not initialized.");
+		return NULL;
+	}
+
+	PyObject *result = PyList_New(0);
+	if (result == NULL || pos < 0 || pos > length)
+		return result;
+
+	pcre_IndexObject_select(self, (const unsigned char *)subject, length, pos);
+
+	for (int i = 0; i < self->count; i++) {
+		if (!INDEX_HAS(self->selected, i))
+			continue;
+
+		if (run) {
+			pcre_RegexObject *regex = (pcre_RegexObject *)PyTuple_GET_ITEM(self->patterns, i);
+			int rc = pcre_RegexObject_exec(regex, subject, length, pos, 0, self->ovector, (regex->groups + 1) * 3);
+			if (rc == REGEX_NOMATCH)
+				continue;
+			if (rc < 0) {
+				sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+				PyErr_SetString(PcreError, message_buffer);
+				Py_DECREF(result);
+				return NULL;
+			}
+		}
+
+		PyObject *index = PyInt_FromLong(i);
+		if (index == NULL || PyList_Append(result, index) < 0) {
+			Py_XDECREF(index);
+			Py_DECREF(result);
+			return NULL;
+		}
+		Py_DECREF(index);
+	}
+
+	return result;
+}
+
+static PyObject *
+pcre_IndexObject_candidates(pcre_IndexObject *self, PyObject *args, PyObject *keywds)
+{
+	return pcre_IndexObject_lookup(self, args, keywds, 0);
+}
+
+static PyObject *
+pcre_IndexObject_search(pcre_IndexObject *self, PyObject *args, PyObject *keywds)
+{
+	return pcre_IndexObject_lookup(self, args, keywds, 1);
+}
+
+static PyObject *
+pcre_IndexObject_getpatterns(pcre_IndexObject *self, void *closure)
+{
+	if (self->patterns == NULL)
+		Py_RETURN_NONE;
+
+	Py_INCREF(self->patterns);
+	return self->patterns;
+}
+
+static PyObject *
+pcre_IndexObject_getunfiltered(pcre_IndexObject *self, void *closure)
+{
+	// patterns which are candidates for any subject long enough
+	int count = 0;
+	for (int i = 0; i < self->count; i++)
+		count += INDEX_HAS(self->any_first, i) && INDEX_HAS(self->any_required, i);
+
+	return Py_BuildValue("i", count);
+}
+
+static PyGetSetDef pcre_IndexObject_getseters[] = {
+	{"patterns", (getter)pcre_IndexObject_getpatterns, NULL, NULL, NULL},
+	{"unfiltered", (getter)pcre_IndexObject_getunfiltered, NULL, NULL, NULL},
+	{NULL}  /* Sentinel */
+};
+
+static PyMethodDef pcre_IndexObject_methods[] = {
+	{"candidates", (PyCFunction)pcre_IndexObject_candidates, METH_VARARGS | METH_KEYWORDS,
+	"Return a list of indexes of patterns which can match string from pos, selected by their first and required bytes and minimal length without running them."},
+	{"search", (PyCFunction)pcre_IndexObject_search, METH_VARARGS | METH_KEYWORDS,
+	"Return a list of indexes of patterns which match string from pos. Only candidates are run."},
+	{NULL}  /* Sentinel */
+};
+
+PyTypeObject pcre_IndexType = {
+	PyObject_HEAD_INIT(NULL)
+	0,                         /*ob_size*/
+	"_pcre.PatternIndex",      /*tp_name*/
+	sizeof(pcre_IndexObject),  /*tp_basicsize*/
+	0,                         /*tp_itemsize*/
+	(destructor)pcre_IndexObject_dealloc, /*tp_dealloc*/
+	0,                         /*tp_print*/
+	0,                         /*tp_getattr*/
+	0,                         /*tp_setattr*/
+	0,                         /*tp_compare*/
+	0,                         /*tp_repr*/
+	0,                         /*tp_as_number*/
+	0,                         /*tp_as_sequence*/
+	0,                         /*tp_as_mapping*/
+	0,                         /*tp_hash */
+	0,                         /*tp_call*/
+	0,                         /*tp_str*/
+	0,                         /*tp_getattro*/
+	0,                         /*tp_setattro*/
+	0,                         /*tp_as_buffer*/
+	Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+	"PatternIndex(patterns) selects RegexObjects of the sequence which can match a string", /* tp_doc */
+	0,		                   /* tp_traverse */
+	0,		                   /* tp_clear */
+	0,		                   /* tp_richcompare */
+	0,		                   /* tp_weaklistoffset */
+	0,		                   /* tp_iter */
+	0,		                   /* tp_iternext */
+	pcre_IndexObject_methods,  /* tp_methods */
+	0,                         /* tp_members */
+	pcre_IndexObject_getseters,/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)pcre_IndexObject_init, /* tp_init */
+	0,                         /* tp_alloc */
+	PyType_GenericNew,         /* tp_new */
+};
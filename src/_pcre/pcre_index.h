@@ -0,0 +1,46 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PCRE_INDEX_H
+#define PCRE_INDEX_H
+
+#include <Python.h>
+#include <stdint.h>
+
+#include "pcre_regex.h"
+
+typedef struct {
+	PyObject_HEAD
+	/* public members */
+	PyObject *patterns;      // tuple of RegexObjects
+	/* private members */
+	int count;
+	int words;               // of each set of patterns, a bit per pattern
+	uint64_t *first;         // [256][words] unanchored patterns which can start by the byte
+	uint64_t *anchored;      // [256][words] anchored patterns which can start by the byte
+	uint64_t *required;      // [256][words] patterns which need the byte somewhere
+	uint64_t *any_first;     // [words] patterns with no known first bytes
+	uint64_t *any_required;  // [words] patterns with no required byte
+	uint64_t *selected;      // [words] work set of candidates
+	int *min_lengths;
+	int *ovector;            // large enough for any of patterns
+} pcre_IndexObject;
+
+extern PyTypeObject pcre_IndexType;
+
+#endif /* PCRE_INDEX_H */
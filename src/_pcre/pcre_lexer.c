@@ -0,0 +1,362 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pcre_module.h"
+#include "pcre_regex.h"
+#include "pcre_lexer.h"
+
+#ifdef USE_PCRE2
+#define LEXER_ANCHORED PCRE2_ANCHORED
+#define LEXER_DUPNAMES PCRE2_DUPNAMES
+#else
+#define LEXER_ANCHORED PCRE_ANCHORED
+#define LEXER_DUPNAMES PCRE_DUPNAMES
+#endif
+
+static void
+pcre_LexerObject_dealloc(pcre_LexerObject* self)
+{
+	free(self->rule_groups);
+	free(self->ovector);
+
+	Py_XDECREF(self->names);
+	Py_XDECREF(self->regex);
+
+	self->ob_type->tp_free((PyObject*)self);
+}
+
+static int
+pcre_LexerObject_init(pcre_LexerObject *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *rules;
+	int flags = 0, optimize = 0, use_jit = 0;
+
+	static char *kwlist[] = {"rules", "flags", "optimize", "use_jit", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iii", kwlist, &rules, &flags, &optimize, &use_jit))
+		return -1;
+
+	PyObject *sequence = PySequence_Fast(rules, "Lexer rules must be a sequence of (name, pattern) tuples.");
+	if (sequence == NULL)
+		return -1;
+
+	self->rules = (int)PySequence_Fast_GET_SIZE(sequence);
+	if (self->rules == 0) {
+		PyErr_SetString(PcreError, "Lexer needs at least one rule.");
+		goto ERROR;
+	}
+
+	self->names = PyTuple_New(self->rules);
+	if (self->names == NULL)
+		goto ERROR;
+
+	self->rule_groups = (int *)malloc(self->rules * sizeof(int));
+	if (self->rule_groups == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the rule groups.");
+		goto ERROR;
+	}
+
+	/*
+	 * rules are compiled into one anchored pattern (rule0)|(rule1)|..., so the first
+	 * rule matching at the current position wins and its wrapping group tells which one;
+	 * rules may reuse names of groups of other rules
+	 */
+	PyObject *combined = PyString_FromString("");
+	if (combined == NULL)
+		goto ERROR;
+
+	int group = 1;
+	for (int i = 0; i < self->rules; i++) {
+		PyObject *rule = PySequence_Fast_GET_ITEM(sequence, i);
+		char *name, *pattern;
+
+		if (!PyTuple_Check(rule) || !PyArg_ParseTuple(rule, "ss", &name, &pattern)) {
+			PyErr_SetString(PyExc_TypeError, "Lexer rule must be a (name, pattern) tuple.");
+			goto ERROR_COMBINED;
+		}
+
+		// capturing groups of the rule itself shift numbers of groups of the following rules
+		pcre_RegexObject *regex = (pcre_RegexObject *)PyObject_CallFunction(
+				(PyObject *)&pcre_RegexType, "si", pattern, flags);
+		if (regex == NULL)
+			goto ERROR_COMBINED;
+
+		if (pcre_RegexObject_refersgroups(regex)) {
+			sprintf(message_buffer, "Lexer rule %d refers to a group, which is renumbered in the combined pattern.", i);
+			PyErr_SetString(PcreError, message_buffer);
+			Py_DECREF(regex);
+			goto ERROR_COMBINED;
+		}
+
+		self->rule_groups[i] = group;
+		group += regex->groups + 1;
+
+		/*
+		 * a rule in extended mode may end in a # comment, which would swallow the closing
+		 * parenthesis, so a newline is appended whenever it is ignored as whitespace
+		 */
+		const char *suffix = "";
+		pcre_RegexObject *terminated = (pcre_RegexObject *)PyObject_CallFunction(
+				(PyObject *)&pcre_RegexType, "Ni", PyString_FromFormat("%s\n", pattern), flags);
+		if (terminated == NULL) {
+			Py_DECREF(regex);
+			goto ERROR_COMBINED;
+		}
+		if (terminated->bytecode_size == regex->bytecode_size)
+			suffix = "\n";
+		Py_DECREF(terminated);
+		Py_DECREF(regex);
+
+		PyObject *rule_name = PyString_FromString(name);
+		if (rule_name == NULL)
+			goto ERROR_COMBINED;
+		PyTuple_SET_ITEM(self->names, i, rule_name);
+
+		PyString_ConcatAndDel(&combined, PyString_FromFormat((i == 0) ? "(%s%s)" : "|(%s%s)", pattern, suffix));
+		if (combined == NULL)
+			goto ERROR;
+	}
+
+	self->regex = (pcre_RegexObject *)PyObject_CallFunction((PyObject *)&pcre_RegexType, "siii",
+			PyString_AS_STRING(combined), flags | LEXER_ANCHORED | LEXER_DUPNAMES, optimize, use_jit);
+	Py_DECREF(combined);
+	if (self->regex == NULL)
+		goto ERROR;
+
+	self->ovector_size = (self->regex->groups + 1) * 3;
+	self->ovector = (int *)malloc(self->ovector_size * sizeof(int));
+	if (self->ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		goto ERROR;
+	}
+
+	Py_DECREF(sequence);
+	return 0;
+
+ERROR_COMBINED:
+	Py_XDECREF(combined);
+
+ERROR:
+	Py_DECREF(sequence);
+	return -1;
+}
+
+/*
+ * Scans subject from *pos while some rule matches. Returns an array of *count
+ * (rule, start, end) triples, which must be freed, and moves *pos where the scanning
+ * stopped. Returns NULL and sets an exception on error.
+ */
+static int *
+pcre_LexerObject_tokenize(pcre_LexerObject *self, const char *subject, int length, int *pos, Py_ssize_t *count)
+{
+	Py_ssize_t capacity = 64;
+	int *tokens = (int *)malloc(capacity * 3 * sizeof(int));
+	if (tokens == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the tokens.");
+		return NULL;
+	}
+
+	*count = 0;
+	while (*pos < length) {
+		int rc = pcre_RegexObject_exec(self->regex, subject, length, *pos, 0, self->ovector, self->ovector_size);
+		if (rc == REGEX_NOMATCH)
+			break;
+		if (rc < 0) {
+			sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+			PyErr_SetString(PcreError, message_buffer);
+			goto ERROR;
+		}
+
+		int rule = 0;
+		while (rule < self->rules - 1 &&
+			   (self->rule_groups[rule] >= rc || self->ovector[2 * self->rule_groups[rule]] < 0))
+			rule++;
+
+		int end = self->ovector[1];
+		if (end == *pos) {
+			sprintf(message_buffer, "Lexer rule %d matched an empty string at offset %d.", rule, end);
+			PyErr_SetString(PcreError, message_buffer);
+			goto ERROR;
+		}
+
+		if (*count == capacity) {
+			capacity *= 2;
+			int *resized = (int *)realloc(tokens, capacity * 3 * sizeof(int));
+			if (resized == NULL) {
+				PyErr_SetString(PcreError, "An error when allocating the tokens.");
+				goto ERROR;
+			}
+			tokens = resized;
+		}
+
+		tokens[*count * 3] = rule;
+		tokens[*count * 3 + 1] = *pos;
+		tokens[*count * 3 + 2] = end;
+		(*count)++;
+
+		*pos = end;
+	}
+
+	return tokens;
+
+ERROR:
+	free(tokens);
+	return NULL;
+}
+
+static PyObject *
+pcre_LexerObject_scan(pcre_LexerObject* self, PyObject *args, PyObject *keywds)
+{
+	char *subject;
+	int length, pos = 0;
+
+	static char *kwlist[] = {"string", "pos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|i", kwlist, &subject, &length, &pos))
+		return NULL;
+
+	if (pos < 0 || pos > length) {
+		PyErr_SetString(PyExc_ValueError, "Position is out of the string.");
+		return NULL;
+	}
+
+	Py_ssize_t count;
+	int *tokens = pcre_LexerObject_tokenize(self, subject, length, &pos, &count);
+	if (tokens == NULL)
+		return NULL;
+
+	PyObject *list = PyList_New(count);
+	if (list == NULL)
+		goto ERROR;
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *token = Py_BuildValue("(iii)", tokens[i * 3], tokens[i * 3 + 1], tokens[i * 3 + 2]);
+		if (token == NULL)
+			goto ERROR_LIST;
+		PyList_SET_ITEM(list, i, token);
+	}
+
+	free(tokens);
+	return Py_BuildValue("(Ni)", list, pos);
+
+ERROR_LIST:
+	Py_DECREF(list);
+
+ERROR:
+	free(tokens);
+	return NULL;
+}
+
+static PyObject *
+pcre_LexerObject_scan_array(pcre_LexerObject* self, PyObject *args, PyObject *keywds)
+{
+	char *subject;
+	int length, pos = 0;
+
+	static char *kwlist[] = {"string", "pos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|i", kwlist, &subject, &length, &pos))
+		return NULL;
+
+	if (pos < 0 || pos > length) {
+		PyErr_SetString(PyExc_ValueError, "Position is out of the string.");
+		return NULL;
+	}
+
+	Py_ssize_t count;
+	int *tokens = pcre_LexerObject_tokenize(self, subject, length, &pos, &count);
+	if (tokens == NULL)
+		return NULL;
+
+	PyObject *array = pcre_new_int_array(tokens, count * 3);
+	free(tokens);
+	if (array == NULL)
+		return NULL;
+
+	return Py_BuildValue("(Ni)", array, pos);
+}
+
+static PyObject *
+pcre_LexerObject_getnames(pcre_LexerObject *self, void *closure)
+{
+	Py_INCREF(self->names);
+	return self->names;
+}
+
+static PyObject *
+pcre_LexerObject_getregex(pcre_LexerObject *self, void *closure)
+{
+	Py_INCREF(self->regex);
+	return (PyObject *)self->regex;
+}
+
+static PyGetSetDef pcre_LexerObject_getseters[] = {
+	{"names", (getter)pcre_LexerObject_getnames, NULL, "Names of the rules, a token refers to them by index.", NULL},
+	{"regex", (getter)pcre_LexerObject_getregex, NULL, "Anchored RegexObject combining all rules.", NULL},
+	{NULL}  /* Sentinel */
+};
+
+static PyMethodDef pcre_LexerObject_methods[] = {
+	{"scan", (PyCFunction)pcre_LexerObject_scan, METH_VARARGS | METH_KEYWORDS,
+	"Split string from pos into tokens while some rule matches. Return a tuple of list of (rule_index, start, end) tuples and the position where scanning stopped."},
+	{"scan_array", (PyCFunction)pcre_LexerObject_scan_array, METH_VARARGS | METH_KEYWORDS,
+	"Same as scan(), but the tokens are returned as flat array('i') of rule_index, start, end triples."},
+	{NULL}  /* Sentinel */
+};
+
+PyTypeObject pcre_LexerType = {
+	PyObject_HEAD_INIT(NULL)
+	0,                         /*ob_size*/
+	"_pcre.Lexer",             /*tp_name*/
+	sizeof(pcre_LexerObject),  /*tp_basicsize*/
+	0,                         /*tp_itemsize*/
+	(destructor)pcre_LexerObject_dealloc, /*tp_dealloc*/
+	0,                         /*tp_print*/
+	0,                         /*tp_getattr*/
+	0,                         /*tp_setattr*/
+	0,                         /*tp_compare*/
+	0,                         /*tp_repr*/
+	0,                         /*tp_as_number*/
+	0,                         /*tp_as_sequence*/
+	0,                         /*tp_as_mapping*/
+	0,                         /*tp_hash */
+	0,                         /*tp_call*/
+	0,                         /*tp_str*/
+	0,                         /*tp_getattro*/
+	0,                         /*tp_setattro*/
+	0,                         /*tp_as_buffer*/
+	Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+	"Lexer(rules, flags=0, optimize=0, use_jit=0) splits strings into tokens by an ordered list of (name, pattern) rules", /* tp_doc */
+	0,		                   /* tp_traverse */
+	0,		                   /* tp_clear */
+	0,		                   /* tp_richcompare */
+	0,		                   /* tp_weaklistoffset */
+	0,		                   /* tp_iter */
+	0,		                   /* tp_iternext */
+	pcre_LexerObject_methods,  /* tp_methods */
+	0,                         /* tp_members */
+	pcre_LexerObject_getseters,/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)pcre_LexerObject_init, /* tp_init */
+	0,                         /* tp_alloc */
+	PyType_GenericNew,         /* tp_new */
+};
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PCRE_LEXER_H
+#define PCRE_LEXER_H
+
+#include <Python.h>
+
+#include "pcre_regex.h"
+
+typedef struct {
+	PyObject_HEAD
+	/* public members */
+	PyObject *names;
+	pcre_RegexObject *regex;
+	/* private members */
+	int rules;
+	int *rule_groups;  // capturing group of combined pattern that wraps each rule
+	int *ovector;
+	int ovector_size;
+} pcre_LexerObject;
+
+extern PyTypeObject pcre_LexerType;
+
+#endif /* PCRE_LEXER_H */
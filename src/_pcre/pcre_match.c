@@ -100,24 +100,25 @@ pcre_MatchObject_expand(pcre_MatchObject* self)
 static PyObject *
 pcre_MatchObject_get_substring(pcre_MatchObject* self, int group)
 {
-	char *substring;
-	int rc = pcre_get_substring(self->subject, self->offsetvector, self->stringcount,
-								group, &substring);
-	if (rc < 0) {
+	// offset vector has the same layout with pcre and pcre2 backends, so substring is sliced directly
+	if (group < 0 || group >= self->stringcount) {
 		sprintf(message_buffer,
-				"Picking of substring exited with an error (group = %d, code = %d).", group, rc);
+				"Picking of substring exited with an error (group = %d, no such substring).", group);
 		PyErr_SetString(PcreError, message_buffer);
 		return NULL;
 	}
 
-	PyObject *result = Py_BuildValue("s", substring);
+	int start = self->offsetvector[2 * group];
+	int end = self->offsetvector[2 * group + 1];
+	if (start < 0) // unset group
+		start = end = 0;
+
+	PyObject *result = PyString_FromStringAndSize(self->subject + start, end - start);
 	if (result == NULL) {
 		PyErr_SetString(PcreError, "An error when building substring object.");
-		pcre_free(substring);
 		return NULL;
 	}
 
-	pcre_free(substring);
 	Py_INCREF(result);
 	return result;
 }
@@ -125,12 +126,10 @@ pcre_MatchObject_get_substring(pcre_MatchObject* self, int group)
 static PyObject *
 pcre_MatchObject_group(pcre_MatchObject* self, PyObject *args)
 {
-	if (PyTuple_Size(args) == (Py_ssize_t) 0)
-		PyTuple_SetItem(args, 0, Py_BuildValue("i", 0));
-
 	Py_ssize_t size = PyTuple_GET_SIZE(args);
 
 	PyObject *result;
+	int *groups = NULL;
 
 	// method called without parameters
 	if (size == 0) {
@@ -142,7 +141,7 @@ pcre_MatchObject_group(pcre_MatchObject* self, PyObject *args)
 		goto RET;
 	}
 
-	int *groups = (int *) malloc(size * sizeof(int));
+	groups = (int *) malloc(size * sizeof(int));
 	if (groups == NULL) {
 		PyErr_SetString(PcreError, "An error when allocating groups.");
 		return NULL;
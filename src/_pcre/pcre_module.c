@@ -18,12 +18,17 @@
 
 
 #include <Python.h>
-#include <pcre.h>
+#include <locale.h>
 
 #include "pcre_module.h"
 
 int jit_enabled;
 char message_buffer[150];
+pcre_MemoryUsage memory_usage;
+pcre_AdaptiveThresholds adaptive_thresholds = {
+	ADAPTIVE_STUDY_CALLS_DEFAULT, ADAPTIVE_STUDY_BYTES_DEFAULT,
+	ADAPTIVE_JIT_CALLS_DEFAULT, ADAPTIVE_JIT_BYTES_DEFAULT
+};
 
 /*
  * EXCEPTIONS
@@ -37,6 +42,101 @@ PyObject *PcreError;
 
 #include "pcre_regex.h"
 #include "pcre_match.h"
+#include "pcre_lexer.h"
+#include "pcre_index.h"
+#include "pcre_state.h"
+#include "pcre_trace.h"
+
+/*
+ * HELPERS
+ */
+
+// returns new array.array('i') with a copy of items
+PyObject *
+pcre_new_int_array(const int *items, Py_ssize_t count)
+{
+	static PyObject *array_type = NULL;
+
+	if (array_type == NULL) {
+		PyObject *array_module = PyImport_ImportModule("array");
+		if (array_module == NULL)
+			return NULL;
+		array_type = PyObject_GetAttrString(array_module, "array");
+		Py_DECREF(array_module);
+		if (array_type == NULL)
+			return NULL;
+	}
+
+	PyObject *data = PyString_FromStringAndSize((const char *)items, count * sizeof(int));
+	if (data == NULL)
+		return NULL;
+
+	PyObject *result = PyObject_CallFunction(array_type, "sO", "i", data);
+	Py_DECREF(data);
+	return result;
+}
+
+static pcre_LocaleTables *locale_tables; // never freed, patterns refer to them
+
+/*
+ * Returns tables of LC_CTYPE category of the locale ("" for the current one), built
+ * on first use. The locale is set only for the calling thread meanwhile.
+ */
+pcre_LocaleTables *
+pcre_locale_tables(const char *locale)
+{
+	if (locale[0] == '\0')
+		locale = setlocale(LC_CTYPE, NULL);
+
+	for (pcre_LocaleTables *item = locale_tables; item != NULL; item = item->next) {
+		if (strcmp(item->locale, locale) == 0)
+			return item;
+	}
+
+	locale_t ctype = newlocale(LC_CTYPE_MASK, locale, (locale_t)0);
+	if (ctype == (locale_t)0) {
+		PyErr_Format(PcreError, "Unsupported locale: %.100s", locale);
+		return NULL;
+	}
+
+	pcre_LocaleTables *item = (pcre_LocaleTables *)calloc(1, sizeof(pcre_LocaleTables));
+	if (item == NULL)
+		goto ERROR;
+
+	locale_t previous = uselocale(ctype);
+#ifdef USE_PCRE2
+	item->tables = pcre2_maketables(NULL);
+#else
+	item->tables = pcre_maketables();
+#endif
+	uselocale(previous);
+
+	item->locale = strdup(locale);
+	if (item->tables == NULL || item->locale == NULL)
+		goto ERROR;
+
+#ifdef USE_PCRE2
+	item->context = pcre2_compile_context_create(NULL);
+	if (item->context == NULL)
+		goto ERROR;
+	pcre2_set_character_tables(item->context, item->tables);
+#endif
+
+	freelocale(ctype);
+	item->next = locale_tables;
+	locale_tables = item;
+	return item;
+
+ERROR:
+	if (item != NULL) {
+		free((void *)item->tables);
+		free(item->locale);
+		free(item);
+	}
+	freelocale(ctype);
+	PyErr_SetString(PcreError, "An error when building the character tables.");
+	return NULL;
+}
 
 /*
  * FUNCTIONS
@@ -51,23 +151,117 @@ pcre_jit_enabled(PyObject *self, PyObject *args)
 static PyObject *
 pcre_jit_target(PyObject *self, PyObject *args)
 {
+#ifdef USE_PCRE2
+	char jit_target[64];
+	if (pcre2_config(PCRE2_CONFIG_JITTARGET, jit_target) < 0)
+		return Py_BuildValue("s", NULL);
+#else
 	const char *jit_target;
 	if (pcre_config(PCRE_CONFIG_JITTARGET, &jit_target) < 0)
 		jit_target = NULL;
+#endif
 	return Py_BuildValue("s", jit_target);
 }
 
 static PyObject *
 pcre_lib_version(PyObject *self, PyObject *args)
 {
+#ifdef USE_PCRE2
+	char version[32];
+	pcre2_config(PCRE2_CONFIG_VERSION, version);
+#else
 	const char *version = pcre_version();
+#endif
 	return Py_BuildValue("s", version);
 }
 
+static PyObject *
+pcre_lib_backend(PyObject *self, PyObject *args)
+{
+#ifdef USE_PCRE2
+	return Py_BuildValue("s", "pcre2");
+#else
+	return Py_BuildValue("s", "pcre");
+#endif
+}
+
+static PyObject *
+pcre_memory_usage(PyObject *self, PyObject *args)
+{
+	size_t total = memory_usage.bytecode + memory_usage.study + memory_usage.jit_code + memory_usage.jit_stack;
+
+	return Py_BuildValue("{s:l,s:l,s:n,s:n,s:n,s:n,s:n,s:l,s:n}",
+						 "patterns", memory_usage.patterns,
+						 "jit_patterns", memory_usage.jit_patterns,
+						 "bytecode", (Py_ssize_t)memory_usage.bytecode,
+						 "study", (Py_ssize_t)memory_usage.study,
+						 "jit_code", (Py_ssize_t)memory_usage.jit_code,
+						 "jit_stack", (Py_ssize_t)memory_usage.jit_stack,
+						 "total", (Py_ssize_t)total,
+						 "twins", memory_usage.twins,
+						 "twin", (Py_ssize_t)memory_usage.twin);
+}
+
+static PyObject *
+pcre_locales(PyObject *self, PyObject *args)
+{
+	PyObject *result = PyList_New(0);
+	if (result == NULL)
+		return NULL;
+
+	for (pcre_LocaleTables *item = locale_tables; item != NULL; item = item->next) {
+		PyObject *name = PyString_FromString(item->locale);
+		if (name == NULL || PyList_Append(result, name) < 0) {
+			Py_XDECREF(name);
+			Py_DECREF(result);
+			return NULL;
+		}
+		Py_DECREF(name);
+	}
+
+	return result;
+}
+
+static PyObject *
+pcre_adaptive_thresholds(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	pcre_AdaptiveThresholds thresholds = adaptive_thresholds;
+
+	static char *kwlist[] = {"study_calls", "study_bytes", "jit_calls", "jit_bytes", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|lLlL", kwlist, &thresholds.study_calls,
+			&thresholds.study_bytes, &thresholds.jit_calls, &thresholds.jit_bytes))
+		return NULL;
+
+	if (thresholds.study_calls < 0 || thresholds.study_bytes < 0 || thresholds.jit_calls < 0 ||
+			thresholds.jit_bytes < 0) {
+		PyErr_SetString(PyExc_ValueError, "Thresholds must not be negative.");
+		return NULL;
+	}
+
+	adaptive_thresholds = thresholds;
+
+	return Py_BuildValue("{s:l,s:L,s:l,s:L}",
+						 "study_calls", adaptive_thresholds.study_calls,
+						 "study_bytes", adaptive_thresholds.study_bytes,
+						 "jit_calls", adaptive_thresholds.jit_calls,
+						 "jit_bytes", adaptive_thresholds.jit_bytes);
+}
+
 static PyMethodDef pcre_functions[] = {
 	{"jit_enabled",  pcre_jit_enabled, METH_NOARGS, "Return True when JIT compilation is enabled."},
 	{"jit_target",  pcre_jit_target, METH_NOARGS, "Return the target architecture of JIT compilation."},
 	{"version",  pcre_lib_version, METH_NOARGS, "Return the version of PCRE library."},
+	{"compile_many",  (PyCFunction)pcre_compile_many, METH_VARARGS | METH_KEYWORDS,
+	"compile_many(specs, threads=0) compiles patterns, or tuples of RegexObject arguments, by native threads (0 for one per CPU). Return a list of RegexObjects in the order of specs, with PcreError instance in place of a pattern which failed."},
+	{"memory_usage",  pcre_memory_usage, METH_NOARGS,
+	"Return a dict with number of live compiled patterns (and JIT-compiled ones among them) and bytes of their bytecode, study data, JIT code and JIT stacks. Capture-free twins are counted among them and also separately."},
+	{"adaptive_thresholds",  (PyCFunction)pcre_adaptive_thresholds, METH_VARARGS | METH_KEYWORDS,
+	"adaptive_thresholds(study_calls, study_bytes, jit_calls, jit_bytes) sets the passed counts of match calls or scanned bytes after which an adaptive RegexObject is studied and JIT-compiled. Return a dict with the current thresholds."},
+	{"perf_map",  pcre_perf_map, METH_VARARGS,
+	"perf_map(enable=True) starts or stops appending JIT code of patterns compiled meanwhile to /tmp/perf-<pid>.map, so perf report names it by the pattern. Return the path of the map or None."},
+	{"locales",  pcre_locales, METH_NOARGS, "Return a list of locales whose character tables are built, each once for all patterns compiled under it."},
+	{"backend",  pcre_lib_backend, METH_NOARGS, "Return the name of PCRE API the module is built against ('pcre' or 'pcre2')."},
 	{NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
@@ -86,6 +280,15 @@ init_pcre(void)
 	if (PyType_Ready(&pcre_MatchType) < 0)
 		return;
 
+	if (PyType_Ready(&pcre_LexerType) < 0)
+		return;
+
+	if (PyType_Ready(&pcre_StateType) < 0)
+		return;
+
+	if (PyType_Ready(&pcre_IndexType) < 0)
+		return;
+
 	m = Py_InitModule("_pcre", pcre_functions);
 	if (m == NULL)
 		return;
@@ -95,6 +298,35 @@ init_pcre(void)
 	PyModule_AddObject(m, "PcreError", PcreError);
 
 	// libpcre constants
+#ifdef USE_PCRE2
+	// PCRE2 has no equivalent of PCRE_EXTRA, PCRE_UTF16 and PCRE_JAVASCRIPT_COMPAT;
+	// newline and \R conventions are set by compile context or (*...) pattern items
+	PyModule_AddIntConstant(m, "PCRE_CASELESS", PCRE2_CASELESS);
+	PyModule_AddIntConstant(m, "PCRE_MULTILINE", PCRE2_MULTILINE);
+	PyModule_AddIntConstant(m, "PCRE_DOTALL", PCRE2_DOTALL);
+	PyModule_AddIntConstant(m, "PCRE_EXTENDED", PCRE2_EXTENDED);
+	PyModule_AddIntConstant(m, "PCRE_ANCHORED", PCRE2_ANCHORED);
+	PyModule_AddIntConstant(m, "PCRE_DOLLAR_ENDONLY", PCRE2_DOLLAR_ENDONLY);
+	PyModule_AddIntConstant(m, "PCRE_NOTBOL", PCRE2_NOTBOL);
+	PyModule_AddIntConstant(m, "PCRE_NOTEOL", PCRE2_NOTEOL);
+	PyModule_AddIntConstant(m, "PCRE_UNGREEDY", PCRE2_UNGREEDY);
+	PyModule_AddIntConstant(m, "PCRE_NOTEMPTY", PCRE2_NOTEMPTY);
+	PyModule_AddIntConstant(m, "PCRE_UTF8", PCRE2_UTF);
+	PyModule_AddIntConstant(m, "PCRE_NO_AUTO_CAPTURE", PCRE2_NO_AUTO_CAPTURE);
+	PyModule_AddIntConstant(m, "PCRE_NO_UTF8_CHECK", PCRE2_NO_UTF_CHECK);
+	PyModule_AddIntConstant(m, "PCRE_AUTO_CALLOUT", PCRE2_AUTO_CALLOUT);
+	PyModule_AddIntConstant(m, "PCRE_PARTIAL_SOFT", PCRE2_PARTIAL_SOFT);
+	PyModule_AddIntConstant(m, "PCRE_PARTIAL", PCRE2_PARTIAL_SOFT);
+	PyModule_AddIntConstant(m, "PCRE_DFA_SHORTEST", PCRE2_DFA_SHORTEST);
+	PyModule_AddIntConstant(m, "PCRE_DFA_RESTART", PCRE2_DFA_RESTART);
+	PyModule_AddIntConstant(m, "PCRE_FIRSTLINE", PCRE2_FIRSTLINE);
+	PyModule_AddIntConstant(m, "PCRE_DUPNAMES", PCRE2_DUPNAMES);
+	PyModule_AddIntConstant(m, "PCRE_NO_START_OPTIMIZE", PCRE2_NO_START_OPTIMIZE);
+	PyModule_AddIntConstant(m, "PCRE_NO_START_OPTIMISE", PCRE2_NO_START_OPTIMIZE);
+	PyModule_AddIntConstant(m, "PCRE_PARTIAL_HARD", PCRE2_PARTIAL_HARD);
+	PyModule_AddIntConstant(m, "PCRE_NOTEMPTY_ATSTART", PCRE2_NOTEMPTY_ATSTART);
+	PyModule_AddIntConstant(m, "PCRE_UCP", PCRE2_UCP);
+#else
 	PyModule_AddIntConstant(m, "PCRE_CASELESS", PCRE_CASELESS);
 	PyModule_AddIntConstant(m, "PCRE_MULTILINE", PCRE_MULTILINE);
 	PyModule_AddIntConstant(m, "PCRE_DOTALL", PCRE_DOTALL);
@@ -130,29 +362,54 @@ init_pcre(void)
 	PyModule_AddIntConstant(m, "PCRE_PARTIAL_HARD", PCRE_PARTIAL_HARD);
 	PyModule_AddIntConstant(m, "PCRE_NOTEMPTY_ATSTART", PCRE_NOTEMPTY_ATSTART);
 	PyModule_AddIntConstant(m, "PCRE_UCP", PCRE_UCP);
+#endif
 
 	// _pcre constants
 	PyModule_AddIntConstant(m, "JIT_STACK_INIT_SIZE", JIT_STACK_INIT_DEFAULT);
 	PyModule_AddIntConstant(m, "JIT_STACK_MAX_SIZE", JIT_STACK_MAX_DEFAULT);
 
 	// run-time checking of utf8 support
+#ifdef USE_PCRE2
+	uint32_t utf8_enabled;
+	if (pcre2_config(PCRE2_CONFIG_UNICODE, &utf8_enabled) < 0) {
+		PyErr_SetString(PcreError, "Error when querying PCRE2_CONFIG_UNICODE.");
+		return;
+	}
+#else
 	const int utf8_enabled;
 	if (pcre_config(PCRE_CONFIG_UTF8, &utf8_enabled) < 0) {
 		PyErr_SetString(PcreError, "Error when querying PCRE_CONFIG_UTF8.");
 		return;
 	}
+#endif
 	if (!utf8_enabled) {
 		PyErr_SetString(PcreError, "Current version of libpcre is compiled without UTF8 support.");
 		return;
 	}
 
 	// run-time checking of jit support
+#ifdef USE_PCRE2
+	uint32_t jit_config;
+	if (pcre2_config(PCRE2_CONFIG_JIT, &jit_config) < 0)
+		jit_config = 0;
+	jit_enabled = (int) jit_config;
+#else
 	if (pcre_config(PCRE_CONFIG_JIT, &jit_enabled) < 0)
 		jit_enabled = 0;
+#endif
 
 	Py_INCREF(&pcre_RegexType);
 	PyModule_AddObject(m, "RegexObject", (PyObject *)&pcre_RegexType);
 
 	Py_INCREF(&pcre_MatchType);
 	PyModule_AddObject(m, "MatchObject", (PyObject *)&pcre_MatchType);
+
+	Py_INCREF(&pcre_LexerType);
+	PyModule_AddObject(m, "Lexer", (PyObject *)&pcre_LexerType);
+
+	Py_INCREF(&pcre_StateType);
+	PyModule_AddObject(m, "MatchState", (PyObject *)&pcre_StateType);
+
+	Py_INCREF(&pcre_IndexType);
+	PyModule_AddObject(m, "PatternIndex", (PyObject *)&pcre_IndexType);
 }
@@ -21,12 +21,58 @@
 
 #include <Python.h>
 
+#ifdef USE_PCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#else
+#include <pcre.h>
+#endif
+
 #define JIT_STACK_INIT_DEFAULT 32*1024
 #define JIT_STACK_MAX_DEFAULT 512*1024
 
+typedef struct {
+	long patterns;
+	long jit_patterns;
+	size_t bytecode;
+	size_t study;
+	size_t jit_code;
+	size_t jit_stack;
+	long twins;
+	size_t twin; // capture-free twins, already included in bytecode and jit_code
+} pcre_MemoryUsage;
+
+// adaptive patterns are studied, then JIT-compiled once either count of a tier is reached
+typedef struct {
+	long study_calls;
+	PY_LONG_LONG study_bytes;
+	long jit_calls;
+	PY_LONG_LONG jit_bytes;
+} pcre_AdaptiveThresholds;
+
+#define ADAPTIVE_STUDY_CALLS_DEFAULT 100
+#define ADAPTIVE_STUDY_BYTES_DEFAULT 64*1024
+#define ADAPTIVE_JIT_CALLS_DEFAULT 1000
+#define ADAPTIVE_JIT_BYTES_DEFAULT 1024*1024
+
+// character tables of a locale, built once and shared by all patterns compiled under it
+typedef struct pcre_LocaleTables {
+	char *locale;
+	const unsigned char *tables;
+#ifdef USE_PCRE2
+	pcre2_compile_context *context; // carries tables, it isn't changed by pcre2_compile()
+#endif
+	struct pcre_LocaleTables *next;
+} pcre_LocaleTables;
+
 extern int jit_enabled;
 extern char message_buffer[150];
+extern pcre_MemoryUsage memory_usage; // totals over all live RegexObjects
+extern pcre_AdaptiveThresholds adaptive_thresholds;
 
 extern PyObject *PcreError;
 
+PyObject *pcre_new_int_array(const int *items, Py_ssize_t count);
+pcre_LocaleTables *pcre_locale_tables(const char *locale);
+
 #endif /* PCRE_MODULE_H */
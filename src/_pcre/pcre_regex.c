@@ -17,10 +17,40 @@
  */
 
 #include <sys/types.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "pcre_module.h"
 #include "pcre_regex.h"
 #include "pcre_match.h"
+#include "pcre_state.h"
+#include "pcre_trace.h"
+
+// character tables of the locale of pattern, NULL for the default ones
+#ifdef USE_PCRE2
+#define REGEX_COMPILE_CONTEXT(self) ((self)->locale != NULL ? (self)->locale->context : NULL)
+#else
+#define REGEX_TABLES(self) ((self)->locale != NULL ? (self)->locale->tables : NULL)
+#endif
+
+// 0 interpreted, 1 studied, 2 JIT-compiled
+#define REGEX_TIER(self) ((self)->use_jit ? 2 : ((self)->optimize ? 1 : 0))
+
+// removes sizes counted by pcre_RegexObject_getsizes() from memory_usage
+static void
+pcre_RegexObject_unaccount(pcre_RegexObject *self)
+{
+	if (self->bytecode_size == 0)
+		return;
+
+	memory_usage.patterns--;
+	if (self->jit_size > 0)
+		memory_usage.jit_patterns--;
+	memory_usage.bytecode -= self->bytecode_size;
+	memory_usage.study -= self->study_size;
+	memory_usage.jit_code -= self->jit_size;
+	memory_usage.jit_stack -= self->jit_stack_size;
+}
 
 static void
 pcre_RegexObject_dealloc(pcre_RegexObject* self)
@@ -29,31 +59,129 @@ pcre_RegexObject_dealloc(pcre_RegexObject* self)
 
 	Py_XDECREF(self->groupindex);
 
+	if (self->twin != NULL) {
+		memory_usage.twins--;
+		memory_usage.twin -= self->twin->bytecode_size + self->twin->jit_size;
+		Py_DECREF(self->twin);
+	}
+
+	pcre_RegexObject_unaccount(self);
+
+#ifdef USE_PCRE2
+	if (self->re != NULL)
+		pcre2_code_free(self->re);
+	if (self->match_data != NULL)
+		pcre2_match_data_free(self->match_data);
+	if (self->match_context != NULL)
+		pcre2_match_context_free(self->match_context);
+	if (self->jit_stack != NULL)
+		pcre2_jit_stack_free(self->jit_stack);
+#else
 	if (self->re != NULL)
 		pcre_free(self->re);
 	if (self->study != NULL)
 		pcre_free_study(self->study);
 	if (self->jit_stack != NULL)
 		pcre_jit_stack_free(self->jit_stack);
+#endif
 
 	self->ob_type->tp_free((PyObject*)self);
 }
 
+/*
+ * Compilation doesn't touch any Python object, so compile_many() runs it without
+ * the GIL. An error is described into message (of at least 150 bytes).
+ */
+#ifdef USE_PCRE2
+/*
+ * pcre2_jit_match() skips the sanity checks of pcre2_match(), UTF validity among them,
+ * so it serves only patterns with JIT code and without UTF, which (*UTF) can set too.
+ */
+static void
+pcre_RegexObject_setjitmatch(pcre_RegexObject *self)
+{
+	uint32_t options = PCRE2_UTF;
+	size_t jit_size = 0;
+
+	pcre2_pattern_info(self->re, PCRE2_INFO_ALLOPTIONS, &options);
+	pcre2_pattern_info(self->re, PCRE2_INFO_JITSIZE, &jit_size);
+	self->jit_match = (jit_size > 0 && !(options & PCRE2_UTF));
+}
+
 static int
-pcre_RegexObject_compile(pcre_RegexObject *self)
+pcre_RegexObject_compile_pattern(pcre_RegexObject *self, char *message)
+{
+	int errorcode;
+	PCRE2_SIZE erroffset;
+	char error[96];
+
+	self->re = pcre2_compile((PCRE2_SPTR)self->pattern, PCRE2_ZERO_TERMINATED, self->flags,
+							 &errorcode, &erroffset, REGEX_COMPILE_CONTEXT(self));
+	if (self->re == NULL) {
+		pcre2_get_error_message(errorcode, (PCRE2_UCHAR *)error, sizeof(error));
+		sprintf(message, "Pattern compilation error at offset %d: %s", (int)erroffset, error);
+		return 0;
+	}
+
+	if (!self->optimize && self->use_jit) {
+		strcpy(message, "Invalid combination of arguments. To enable JIT you must enable pattern optimization.");
+		return 0;
+	}
+
+	// one match block sized for all groups of the pattern is reused by every match() call
+	self->match_data = pcre2_match_data_create_from_pattern(self->re, NULL);
+	if (self->match_data == NULL) {
+		strcpy(message, "An error when allocating the match data block.");
+		return 0;
+	}
+
+	self->match_context = pcre2_match_context_create(NULL);
+	if (self->match_context == NULL) {
+		strcpy(message, "An error when allocating the match context.");
+		return 0;
+	}
+
+	// pcre2_compile() does the work of pcre_study() itself, only JIT remains
+	if (!self->use_jit)
+		return 1;
+
+	if (!jit_enabled) {
+		strcpy(message, "Current version of libpcre is compiled without JIT support.");
+		return 0;
+	}
+
+	errorcode = pcre2_jit_compile(self->re, PCRE2_JIT_COMPLETE);
+	if (errorcode != 0) {
+		pcre2_get_error_message(errorcode, (PCRE2_UCHAR *)error, sizeof(error));
+		sprintf(message, "Pattern JIT compilation error: %s", error);
+		return 0;
+	}
+
+	self->jit_stack = pcre2_jit_stack_create(self->jit_stack_init, self->jit_stack_max, NULL);
+	if (self->jit_stack == NULL) {
+		strcpy(message, "JIT stack allocation exited with an error.");
+		return 0;
+	}
+	pcre2_jit_stack_assign(self->match_context, NULL, self->jit_stack);
+	pcre_RegexObject_setjitmatch(self);
+
+	return 1;
+}
+#else
+static int
+pcre_RegexObject_compile_pattern(pcre_RegexObject *self, char *message)
 {
 	char *error;
 	int erroffset;
 
-	self->re = pcre_compile(self->pattern, self->flags, &error, &erroffset, NULL);
+	self->re = pcre_compile(self->pattern, self->flags, &error, &erroffset, REGEX_TABLES(self));
 	if (self->re == NULL) {
-	  	sprintf(message_buffer, "Pattern compilation error at offset %d: %s", erroffset, error);
-		PyErr_SetString(PcreError, message_buffer);
+		sprintf(message, "Pattern compilation error at offset %d: %s", erroffset, error);
 		return 0;
 	}
 
 	if (!self->optimize && self->use_jit) {
-		PyErr_SetString(PcreError, "Invalid combination of arguments. To enable JIT you must enable pattern optimization.");
+		strcpy(message, "Invalid combination of arguments. To enable JIT you must enable pattern optimization.");
 		return 0;
 	}
 
@@ -64,7 +192,7 @@ pcre_RegexObject_compile(pcre_RegexObject *self)
 
 	if (self->use_jit) {
 		if (!jit_enabled) {
-			PyErr_SetString(PcreError, "Current version of libpcre is compiled without JIT support.");
+			strcpy(message, "Current version of libpcre is compiled without JIT support.");
 			return 0;
 		}
 
@@ -73,8 +201,7 @@ pcre_RegexObject_compile(pcre_RegexObject *self)
 
 	self->study = pcre_study(self->re, options, &error); // can return NULL when success
 	if (error != NULL) {
-		sprintf(message_buffer, "Pattern study error: %s", error);
-		PyErr_SetString(PcreError, message_buffer);
+		sprintf(message, "Pattern study error: %s", error);
 		return 0;
 	}
 
@@ -85,13 +212,36 @@ pcre_RegexObject_compile(pcre_RegexObject *self)
 
 	self->jit_stack = pcre_jit_stack_alloc(self->jit_stack_init, self->jit_stack_max);
 	if (self->jit_stack == NULL) {
-		PyErr_SetString(PcreError, "JIT stack allocation exited with an error.");
+		strcpy(message, "JIT stack allocation exited with an error.");
 		return 0;
 	}
 	pcre_assign_jit_stack(self->study, NULL, self->jit_stack);
 
 	return 1;
 }
+#endif
+
+static int
+pcre_RegexObject_compile_nogil(pcre_RegexObject *self, char *message)
+{
+	if (TRACE_COMPILE_ENABLED()) {
+		PY_LONG_LONG started = pcre_trace_now();
+		int ok = pcre_RegexObject_compile_pattern(self, message);
+		TRACE_COMPILE(self, self->pattern, ok, pcre_trace_now() - started);
+		return ok;
+	}
+	return pcre_RegexObject_compile_pattern(self, message);
+}
+
+static int
+pcre_RegexObject_compile(pcre_RegexObject *self)
+{
+	if (!pcre_RegexObject_compile_nogil(self, message_buffer)) {
+		PyErr_SetString(PcreError, message_buffer);
+		return 0;
+	}
+	return 1;
+}
 
 static int
 pcre_RegexObject_getinfo(pcre_RegexObject *self)
@@ -99,14 +249,14 @@ pcre_RegexObject_getinfo(pcre_RegexObject *self)
 	int rc, capturecount, namecount, nameentrysize;
 	unsigned char *nametable;
 
-	rc = pcre_fullinfo(self->re, self->study, PCRE_INFO_CAPTURECOUNT, &capturecount);
+	rc = pcre_RegexObject_fullinfo(self, INFO_CAPTURECOUNT, &capturecount);
 	if (rc != 0) {
 		sprintf(message_buffer, "Detecting of number of capturing subpatterns exited with an error (code = %d).", rc);
 		PyErr_SetString(PcreError, message_buffer);
 		return 0;
 	}
 
-	rc = pcre_fullinfo(self->re, self->study, PCRE_INFO_NAMECOUNT, &namecount);
+	rc = pcre_RegexObject_fullinfo(self, INFO_NAMECOUNT, &namecount);
 	if (rc != 0) {
 		sprintf(message_buffer,
 				"Detecting of named capturing subpatterns exited with an error (PCRE_INFO_NAMECOUNT, code = %d).", rc);
@@ -117,7 +267,7 @@ pcre_RegexObject_getinfo(pcre_RegexObject *self)
 	if (namecount == 0)
 		goto DONE;
 
-	rc = pcre_fullinfo(self->re, self->study, PCRE_INFO_NAMEENTRYSIZE, &nameentrysize);
+	rc = pcre_RegexObject_fullinfo(self, INFO_NAMEENTRYSIZE, &nameentrysize);
 	if (rc != 0) {
 		sprintf(message_buffer,
 				"Detecting of named capturing subpatterns exited with an error (PCRE_INFO_NAMEENTRYSIZE, code = %d).", rc);
@@ -125,7 +275,7 @@ pcre_RegexObject_getinfo(pcre_RegexObject *self)
 		return 0;
 	}
 
-	rc = pcre_fullinfo(self->re, self->study, PCRE_INFO_NAMETABLE, &nametable);
+	rc = pcre_RegexObject_fullinfo(self, INFO_NAMETABLE, &nametable);
 	if (rc != 0) {
 		sprintf(message_buffer,
 				"Detecting of named capturing subpatterns exited with an error (PCRE_INFO_NAMETABLE, code = %d).", rc);
@@ -167,35 +317,307 @@ DONE:
 	return 1;
 }
 
+/*
+ * Entry of the JIT code for the perf map. Neither API exports it, but both libraries keep
+ * it first in their executable_functions, pointed to by the public pcre_extra (legacy)
+ * or by pcre2_code after its memory control and tables. The layouts are private,
+ * so the entry is read only from the versions checked to have them, NULL otherwise.
+ */
+#ifdef USE_PCRE2
+#define HAVE_JIT_ENTRY (PCRE2_MAJOR == 10 && PCRE2_MINOR <= 42)
+#else
+#define HAVE_JIT_ENTRY (PCRE_MAJOR == 8 && PCRE_MINOR >= 20 && PCRE_MINOR <= 45)
+#endif
+
+static const void *
+pcre_RegexObject_jitcode(pcre_RegexObject *self)
+{
+#if !HAVE_JIT_ENTRY
+	return NULL;
+#else
+#ifdef USE_PCRE2
+	typedef struct {
+		void *(*malloc)(size_t, void *);
+		void (*free)(void *, void *);
+		void *memory_data;
+		const uint8_t *tables;
+		void *executable_jit;
+	} code_head;
+
+	void **functions = (void **)((code_head *)self->re)->executable_jit;
+#else
+	if (self->study == NULL || !(self->study->flags & PCRE_EXTRA_EXECUTABLE_JIT))
+		return NULL;
+
+	void **functions = (void **)self->study->executable_jit;
+#endif
+	return (functions == NULL) ? NULL : functions[0];
+#endif
+}
+
 static int
-pcre_RegexObject_init(pcre_RegexObject *self, PyObject *args, PyObject *kwds)
+pcre_RegexObject_getsizes(pcre_RegexObject *self)
+{
+	int rc;
+
+	rc = pcre_RegexObject_fullinfo(self, INFO_SIZE, &self->bytecode_size);
+	if (rc == 0)
+		rc = pcre_RegexObject_fullinfo(self, INFO_JITSIZE, &self->jit_size);
+#ifndef USE_PCRE2
+	if (rc == 0)
+		rc = pcre_RegexObject_fullinfo(self, INFO_STUDYSIZE, &self->study_size);
+#endif
+	if (rc != 0) {
+		sprintf(message_buffer, "Detecting of pattern memory size exited with an error (code = %d).", rc);
+		PyErr_SetString(PcreError, message_buffer);
+		return 0;
+	}
+
+	// the whole maximum size of JIT stack is reserved when allocated
+	if (self->jit_stack != NULL)
+		self->jit_stack_size = self->jit_stack_max;
+
+	if (perf_map_enabled && self->jit_size > 0)
+		pcre_perf_map_add(pcre_RegexObject_jitcode(self), self->jit_size, self->pattern);
+
+	memory_usage.patterns++;
+	if (self->jit_size > 0)
+		memory_usage.jit_patterns++;
+	memory_usage.bytecode += self->bytecode_size;
+	memory_usage.study += self->study_size;
+	memory_usage.jit_code += self->jit_size;
+	memory_usage.jit_stack += self->jit_stack_size;
+
+	return 1;
+}
+
+// parses arguments of RegexObject() and copies the pattern, compilation is left to the caller
+static int
+pcre_RegexObject_setup(pcre_RegexObject *self, PyObject *args, PyObject *kwds)
 {
 	self->jit_stack_init = JIT_STACK_INIT_DEFAULT;
 	self->jit_stack_max = JIT_STACK_MAX_DEFAULT;
 	self->groupindex = Py_BuildValue("{}"); // FIXME: zjistit, zda tyto funkce zvysuji pocitadlo objektu!!!
 	if (self->groupindex == NULL)
-		return -1;
+		return 0;
 
-	static char *kwlist[] = {"pattern", "flags", "optimize", "use_jit", "jit_stack_init", "jit_stack_max", NULL};
+	static char *kwlist[] = {"pattern", "flags", "optimize", "use_jit", "jit_stack_init", "jit_stack_max",
+							 "adaptive", "locale", NULL};
 
-	char *tmp;
-	if (! PyArg_ParseTupleAndKeywords(args, kwds, "s|iiiii", kwlist, &tmp, &self->flags, &self->optimize,
-			&self->use_jit, &self->jit_stack_init, &self->jit_stack_max))
-		return -1;
+	char *tmp, *locale = NULL;
+	if (! PyArg_ParseTupleAndKeywords(args, kwds, "s|iiiiiiz", kwlist, &tmp, &self->flags, &self->optimize,
+			&self->use_jit, &self->jit_stack_init, &self->jit_stack_max, &self->adaptive, &locale))
+		return 0;
+
+	// tables are looked up here, with the GIL, compile_many() compiles without it
+	if (locale != NULL) {
+		self->locale = pcre_locale_tables(locale);
+		if (self->locale == NULL)
+			return 0;
+	}
 
 	int len = strlen(tmp) + 1;
 	self->pattern = (char *)malloc(len * sizeof(char)); // FIXME: malloc error
 	strcpy(self->pattern, tmp);
 
+	return 1;
+}
+
+static int
+pcre_RegexObject_init(pcre_RegexObject *self, PyObject *args, PyObject *kwds)
+{
+	if (!pcre_RegexObject_setup(self, args, kwds))
+		return -1;
+
 	if (!pcre_RegexObject_compile(self))
 		return -1;
 
 	if (!pcre_RegexObject_getinfo(self))
 		return -1;
 
+	if (!pcre_RegexObject_getsizes(self))
+		return -1;
+
 	return 0;
 }
 
+/*
+ * Parallel compilation. Patterns are compiled and JIT-compiled by native threads
+ * without the GIL, everything touching Python objects is done before and after.
+ */
+
+typedef struct {
+	pcre_RegexObject **regexes;
+	char (*messages)[150];
+	int *compiled;
+	Py_ssize_t count;
+	Py_ssize_t next;    // next pattern to compile, taken under lock
+	pthread_mutex_t lock;
+} pcre_CompileBatch;
+
+static void *
+pcre_CompileBatch_worker(void *data)
+{
+	pcre_CompileBatch *batch = (pcre_CompileBatch *)data;
+
+	for (;;) {
+		pthread_mutex_lock(&batch->lock);
+		Py_ssize_t i = batch->next++;
+		pthread_mutex_unlock(&batch->lock);
+
+		if (i >= batch->count)
+			break;
+		if (batch->regexes[i] != NULL)
+			batch->compiled[i] = pcre_RegexObject_compile_nogil(batch->regexes[i], batch->messages[i]);
+	}
+
+	return NULL;
+}
+
+// returns instance of the current exception and clears it
+static PyObject *
+pcre_RegexObject_fetchexception(void)
+{
+	PyObject *type, *value, *traceback;
+
+	PyErr_Fetch(&type, &value, &traceback);
+	PyErr_NormalizeException(&type, &value, &traceback);
+	Py_XDECREF(type);
+	Py_XDECREF(traceback);
+
+	return value;
+}
+
+PyObject *
+pcre_compile_many(PyObject *module, PyObject *args, PyObject *kwds)
+{
+	PyObject *specs;
+	int threads = 0;
+
+	static char *kwlist[] = {"specs", "threads", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|i", kwlist, &specs, &threads))
+		return NULL;
+
+	PyObject *sequence = PySequence_Fast(specs, "Specs must be a sequence of patterns or tuples of RegexObject arguments.");
+	if (sequence == NULL)
+		return NULL;
+
+	PyObject *result = NULL;
+	pcre_CompileBatch batch;
+	memset(&batch, 0, sizeof(batch));
+	batch.count = PySequence_Fast_GET_SIZE(sequence);
+
+	batch.regexes = (pcre_RegexObject **)calloc(batch.count + 1, sizeof(pcre_RegexObject *));
+	batch.messages = calloc(batch.count + 1, sizeof(*batch.messages));
+	batch.compiled = (int *)calloc(batch.count + 1, sizeof(int));
+	if (batch.regexes == NULL || batch.messages == NULL || batch.compiled == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the batch.");
+		goto DONE;
+	}
+
+	result = PyList_New(batch.count);
+	if (result == NULL)
+		goto DONE;
+
+	// arguments are parsed upfront, a bad spec becomes an error in the result
+	for (Py_ssize_t i = 0; i < batch.count; i++) {
+		PyObject *spec = PySequence_Fast_GET_ITEM(sequence, i);
+		PyObject *spec_args;
+
+		if (PyTuple_Check(spec)) {
+			Py_INCREF(spec);
+			spec_args = spec;
+		}
+		else
+			spec_args = PyTuple_Pack(1, spec);
+		if (spec_args == NULL)
+			goto ERROR;
+
+		pcre_RegexObject *regex = (pcre_RegexObject *)PyType_GenericNew(&pcre_RegexType, NULL, NULL);
+		if (regex == NULL) {
+			Py_DECREF(spec_args);
+			goto ERROR;
+		}
+
+		int ready = pcre_RegexObject_setup(regex, spec_args, NULL);
+		Py_DECREF(spec_args);
+
+		if (ready)
+			batch.regexes[i] = regex;
+		else {
+			Py_DECREF(regex);
+			PyList_SET_ITEM(result, i, pcre_RegexObject_fetchexception());
+		}
+	}
+
+	if (threads <= 0)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > batch.count)
+		threads = (int)batch.count;
+	if (threads < 1)
+		threads = 1;
+
+	pthread_t *workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+	if (workers == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the threads.");
+		goto ERROR;
+	}
+
+	pthread_mutex_init(&batch.lock, NULL);
+
+	Py_BEGIN_ALLOW_THREADS
+	// the calling thread is one of the workers, it finishes the batch when no other one can start
+	int started = 0;
+	for (int i = 1; i < threads; i++) {
+		if (pthread_create(&workers[started], NULL, pcre_CompileBatch_worker, &batch) != 0)
+			break;
+		started++;
+	}
+	pcre_CompileBatch_worker(&batch);
+	for (int i = 0; i < started; i++)
+		pthread_join(workers[i], NULL);
+	Py_END_ALLOW_THREADS
+
+	pthread_mutex_destroy(&batch.lock);
+	free(workers);
+
+	for (Py_ssize_t i = 0; i < batch.count; i++) {
+		pcre_RegexObject *regex = batch.regexes[i];
+		if (regex == NULL)
+			continue;
+
+		if (!batch.compiled[i])
+			PyList_SET_ITEM(result, i, PyObject_CallFunction(PcreError, "s", batch.messages[i]));
+		else if (!pcre_RegexObject_getinfo(regex) || !pcre_RegexObject_getsizes(regex))
+			PyList_SET_ITEM(result, i, pcre_RegexObject_fetchexception());
+		else {
+			Py_INCREF(regex);
+			PyList_SET_ITEM(result, i, (PyObject *)regex);
+		}
+
+		if (PyList_GET_ITEM(result, i) == NULL)
+			goto ERROR;
+	}
+
+	goto DONE;
+
+ERROR:
+	Py_CLEAR(result);
+
+DONE:
+	if (batch.regexes != NULL) {
+		for (Py_ssize_t i = 0; i < batch.count; i++)
+			Py_XDECREF(batch.regexes[i]);
+	}
+	free(batch.regexes);
+	free(batch.messages);
+	free(batch.compiled);
+	Py_DECREF(sequence);
+
+	return result;
+}
+
 static PyObject *
 pcre_RegexObject_getflags(pcre_RegexObject *self, void *closure)
 {
@@ -221,6 +643,12 @@ pcre_RegexObject_getpattern(pcre_RegexObject *self, void *closure)
 	return Py_BuildValue("s", self->pattern);
 }
 
+static PyObject *
+pcre_RegexObject_getlocale(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("z", (self->locale != NULL) ? self->locale->locale : NULL);
+}
+
 static PyObject *
 pcre_RegexObject_getoptimized(pcre_RegexObject *self, void *closure)
 {
@@ -233,6 +661,139 @@ pcre_RegexObject_getusejit(pcre_RegexObject *self, void *closure)
 	return Py_BuildValue("i", self->use_jit);
 }
 
+static PyObject *
+pcre_RegexObject_getbytecodesize(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("n", (Py_ssize_t)self->bytecode_size);
+}
+
+static PyObject *
+pcre_RegexObject_getstudysize(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("n", (Py_ssize_t)self->study_size);
+}
+
+static PyObject *
+pcre_RegexObject_getjitsize(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("n", (Py_ssize_t)self->jit_size);
+}
+
+static PyObject *
+pcre_RegexObject_gettwinsize(pcre_RegexObject *self, void *closure)
+{
+	if (self->twin == NULL)
+		return Py_BuildValue("n", (Py_ssize_t)0);
+	return Py_BuildValue("n", (Py_ssize_t)(self->twin->bytecode_size + self->twin->jit_size));
+}
+
+static PyObject *
+pcre_RegexObject_getjitcompiled(pcre_RegexObject *self, void *closure)
+{
+	// pcre_study() doesn't fail when JIT compilation does, it just doesn't produce any code
+	return PyBool_FromLong(self->jit_size > 0);
+}
+
+static PyObject *
+pcre_RegexObject_gettier(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("i", REGEX_TIER(self));
+}
+
+static PyObject *
+pcre_RegexObject_getadaptive(pcre_RegexObject *self, void *closure)
+{
+	return PyBool_FromLong(self->adaptive);
+}
+
+static PyObject *
+pcre_RegexObject_getexeccalls(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("l", self->exec_calls);
+}
+
+static PyObject *
+pcre_RegexObject_getexecbytes(pcre_RegexObject *self, void *closure)
+{
+	return Py_BuildValue("L", self->exec_bytes);
+}
+
+static PyObject *
+pcre_RegexObject_getinfoint(pcre_RegexObject *self, int rc, int value)
+{
+	if (rc != 0) {
+		sprintf(message_buffer, "Querying of pattern information exited with an error (code = %d).", rc);
+		PyErr_SetString(PcreError, message_buffer);
+		return NULL;
+	}
+	return Py_BuildValue("i", value);
+}
+
+static PyObject *
+pcre_RegexObject_getminlength(pcre_RegexObject *self, void *closure)
+{
+	int minlength; // -1 when legacy pattern isn't studied
+	int rc = pcre_RegexObject_fullinfo(self, INFO_MINLENGTH, &minlength);
+	return pcre_RegexObject_getinfoint(self, rc, minlength);
+}
+
+static PyObject *
+pcre_RegexObject_getbackrefmax(pcre_RegexObject *self, void *closure)
+{
+	int backrefmax;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_BACKREFMAX, &backrefmax);
+	return pcre_RegexObject_getinfoint(self, rc, backrefmax);
+}
+
+static PyObject *
+pcre_RegexObject_getanchored(pcre_RegexObject *self, void *closure)
+{
+	// options include PCRE_ANCHORED also when the pattern is anchored by its structure
+#ifdef USE_PCRE2
+	uint32_t options;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_ALLOPTIONS, &options);
+	return pcre_RegexObject_getinfoint(self, rc, (options & PCRE2_ANCHORED) != 0);
+#else
+	unsigned long int options;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_OPTIONS, &options);
+	return pcre_RegexObject_getinfoint(self, rc, (options & PCRE_ANCHORED) != 0);
+#endif
+}
+
+static PyObject *
+pcre_RegexObject_getfirstbyte(pcre_RegexObject *self, void *closure)
+{
+	// the same values as PCRE_INFO_FIRSTBYTE: the byte, -1 for start of line, -2 otherwise
+#ifdef USE_PCRE2
+	uint32_t type, unit = 0;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_FIRSTCODETYPE, &type);
+	if (rc == 0 && type == 1)
+		rc = pcre_RegexObject_fullinfo(self, INFO_FIRSTCODEUNIT, &unit);
+	return pcre_RegexObject_getinfoint(self, rc, type == 1 ? (int)unit : (type == 2 ? -1 : -2));
+#else
+	int firstbyte;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_FIRSTBYTE, &firstbyte);
+	return pcre_RegexObject_getinfoint(self, rc, firstbyte);
+#endif
+}
+
+static PyObject *
+pcre_RegexObject_getrequiredbyte(pcre_RegexObject *self, void *closure)
+{
+	// the same values as PCRE_INFO_LASTLITERAL: the byte or -1
+#ifdef USE_PCRE2
+	uint32_t type, unit = 0;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_LASTCODETYPE, &type);
+	if (rc == 0 && type == 1)
+		rc = pcre_RegexObject_fullinfo(self, INFO_LASTCODEUNIT, &unit);
+	return pcre_RegexObject_getinfoint(self, rc, type == 1 ? (int)unit : -1);
+#else
+	int lastliteral;
+	int rc = pcre_RegexObject_fullinfo(self, INFO_LASTLITERAL, &lastliteral);
+	return pcre_RegexObject_getinfoint(self, rc, lastliteral);
+#endif
+}
+
 // TODO: doplnit docstringy
 static PyGetSetDef pcre_RegexObject_getseters[] = {
 	{"flags", (getter)pcre_RegexObject_getflags, NULL, NULL, NULL},
@@ -240,7 +801,22 @@ static PyGetSetDef pcre_RegexObject_getseters[] = {
 	{"groups", (getter)pcre_RegexObject_getgroups, NULL, NULL, NULL},
 	{"pattern", (getter)pcre_RegexObject_getpattern, NULL, NULL, NULL},
 	{"optimized", (getter)pcre_RegexObject_getoptimized, NULL, NULL, NULL},
+	{"locale", (getter)pcre_RegexObject_getlocale, NULL, NULL, NULL},
 	{"use_jit", (getter)pcre_RegexObject_getusejit, NULL, NULL, NULL},
+	{"bytecode_size", (getter)pcre_RegexObject_getbytecodesize, NULL, NULL, NULL},
+	{"study_size", (getter)pcre_RegexObject_getstudysize, NULL, NULL, NULL},
+	{"jit_size", (getter)pcre_RegexObject_getjitsize, NULL, NULL, NULL},
+	{"jit_compiled", (getter)pcre_RegexObject_getjitcompiled, NULL, NULL, NULL},
+	{"twin_size", (getter)pcre_RegexObject_gettwinsize, NULL, NULL, NULL},
+	{"min_length", (getter)pcre_RegexObject_getminlength, NULL, NULL, NULL},
+	{"backref_max", (getter)pcre_RegexObject_getbackrefmax, NULL, NULL, NULL},
+	{"anchored", (getter)pcre_RegexObject_getanchored, NULL, NULL, NULL},
+	{"first_byte", (getter)pcre_RegexObject_getfirstbyte, NULL, NULL, NULL},
+	{"required_byte", (getter)pcre_RegexObject_getrequiredbyte, NULL, NULL, NULL},
+	{"adaptive", (getter)pcre_RegexObject_getadaptive, NULL, NULL, NULL},
+	{"tier", (getter)pcre_RegexObject_gettier, NULL, NULL, NULL},
+	{"exec_calls", (getter)pcre_RegexObject_getexeccalls, NULL, NULL, NULL},
+	{"exec_bytes", (getter)pcre_RegexObject_getexecbytes, NULL, NULL, NULL},
 	{NULL}  /* Sentinel */
 };
 
@@ -258,24 +834,174 @@ pcre_RegexObject_finditer(pcre_RegexObject* self)
 	return NULL;
 }
 
-static PyObject *
-pcre_RegexObject_match(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
-{
-	char *subject;
-	int pos = INT_MIN, endpos = INT_MIN; // values of non-passed parameters
+/*
+ * Tiered compilation. An adaptive pattern starts interpreted (tier 0) and it is studied
+ * (tier 1) and JIT-compiled (tier 2) once its calls or scanned bytes reach adaptive_thresholds.
+ * Only a call holding the GIL promotes the pattern and never while mask() matches without it.
+ */
 
-	static char *kwlist[] = {"string", "pos", "endpos", NULL};
+static int
+pcre_RegexObject_promote(pcre_RegexObject *self, int tier)
+{
+#ifdef USE_PCRE2
+	// pcre2_compile() has studied the pattern already
+	if (tier >= 2 && !self->use_jit) {
+		if (pcre2_jit_compile(self->re, PCRE2_JIT_COMPLETE) != 0)
+			return 0;
 
-	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s|ii", kwlist, &subject, &pos, &endpos))
-		return NULL;
+		self->jit_stack = pcre2_jit_stack_create(self->jit_stack_init, self->jit_stack_max, NULL);
+		if (self->jit_stack == NULL)
+			return 0;
+		pcre2_jit_stack_assign(self->match_context, NULL, self->jit_stack);
+		pcre_RegexObject_setjitmatch(self);
+		self->use_jit = 1;
+	}
+	self->optimize = 1;
+#else
+	// the study can't be extended by JIT code, a new one replaces it
+	const char *error;
+	pcre_extra *study = pcre_study(self->re, (tier >= 2) ? PCRE_STUDY_JIT_COMPILE : 0, &error);
+	if (error != NULL)
+		return 0;
 
-	// negative positions aren't accepted
-	if ((pos < 0 && pos != INT_MIN) || (endpos < 0 && endpos != INT_MIN)) {
-		Py_RETURN_NONE;
+	pcre_jit_stack *jit_stack = NULL;
+	if (tier >= 2 && study != NULL) {
+		jit_stack = pcre_jit_stack_alloc(self->jit_stack_init, self->jit_stack_max);
+		if (jit_stack == NULL) {
+			pcre_free_study(study);
+			return 0;
+		}
+		pcre_assign_jit_stack(study, NULL, jit_stack);
 	}
 
-	int subject_len = strlen(subject);
-	int lastindex = subject_len - 1;
+	if (self->study != NULL)
+		pcre_free_study(self->study);
+	self->study = study;
+	self->jit_stack = jit_stack;
+	self->optimize = 1;
+	self->use_jit = (jit_stack != NULL);
+#endif
+
+	return 1;
+}
+
+// counts a use of the pattern (or of its twin) and promotes it when the next tier is due
+static void
+pcre_RegexObject_adapt(pcre_RegexObject *self, long calls, PY_LONG_LONG bytes)
+{
+	if (self->owner != NULL)
+		self = self->owner;
+
+	self->exec_calls += calls;
+	self->exec_bytes += bytes;
+
+	if (!self->adaptive || self->nogil_users > 0 || (self->twin != NULL && self->twin->nogil_users > 0))
+		return;
+
+	int tier = REGEX_TIER(self), target = tier;
+	if (self->exec_calls >= adaptive_thresholds.study_calls || self->exec_bytes >= adaptive_thresholds.study_bytes)
+		target = 1;
+	if (jit_enabled && (self->exec_calls >= adaptive_thresholds.jit_calls ||
+						self->exec_bytes >= adaptive_thresholds.jit_bytes))
+		target = 2;
+	if (target <= tier)
+		return;
+
+	pcre_RegexObject_unaccount(self);
+	if (!pcre_RegexObject_promote(self, target))
+		self->adaptive = 0; // stays at the tier it has reached
+	if (!pcre_RegexObject_getsizes(self)) {
+		PyErr_Clear();
+		self->bytecode_size = 0; // not accounted anymore
+	}
+
+	pcre_RegexObject *twin = self->twin;
+	if (twin == NULL)
+		return;
+
+	memory_usage.twin -= twin->bytecode_size + twin->jit_size;
+	pcre_RegexObject_unaccount(twin);
+	pcre_RegexObject_promote(twin, REGEX_TIER(self));
+	if (!pcre_RegexObject_getsizes(twin)) {
+		PyErr_Clear();
+		twin->bytecode_size = twin->jit_size = 0;
+	}
+	memory_usage.twin += twin->bytecode_size + twin->jit_size;
+}
+
+/*
+ * Matches subject[0:length] from offset start and fills ovector (of ovector_size
+ * items, the last third is workspace as with pcre_exec()) with offsets of the match
+ * and its groups. Returns the same values as pcre_exec(), REGEX_NOMATCH when the
+ * subject doesn't match. Exceptions are left to the caller.
+ */
+static int
+pcre_RegexObject_execpattern(pcre_RegexObject *self, const char *subject, int length, int start, int options,
+							 int *ovector, int ovector_size)
+{
+#ifdef USE_PCRE2
+	int rc;
+	if (start > length)
+		rc = PCRE2_ERROR_BADOFFSET; // pcre2_jit_match() doesn't check its arguments
+	else if (self->jit_match)
+		rc = pcre2_jit_match(self->re, (PCRE2_SPTR)subject, length, start, options,
+							 self->match_data, self->match_context);
+	else
+		rc = pcre2_match(self->re, (PCRE2_SPTR)subject, length, start, options,
+						 self->match_data, self->match_context);
+
+	if (rc == PCRE2_ERROR_NOMATCH)
+		return REGEX_NOMATCH;
+	if (rc < 0)
+		return rc;
+
+	int pairs = ovector_size / 3;
+	if (pairs > self->groups + 1)
+		pairs = self->groups + 1;
+
+	PCRE2_SIZE *offsets = pcre2_get_ovector_pointer(self->match_data);
+	for (int i = 0; i < pairs * 2; i++)
+		ovector[i] = (offsets[i] == PCRE2_UNSET) ? -1 : (int)offsets[i];
+
+	return (rc > pairs) ? 0 : rc; // 0 when ovector is too small, as pcre_exec() does
+#else
+	return pcre_exec(self->re, self->study, subject, length, start, options, ovector, ovector_size);
+#endif
+}
+
+int
+pcre_RegexObject_exec(pcre_RegexObject *self, const char *subject, int length, int start, int options,
+					  int *ovector, int ovector_size)
+{
+	pcre_RegexObject_adapt(self, 1, length - start);
+
+	if (TRACE_MATCH_ENABLED()) {
+		PY_LONG_LONG started = pcre_trace_now();
+		int rc = pcre_RegexObject_execpattern(self, subject, length, start, options, ovector, ovector_size);
+		TRACE_MATCH(self, length, rc, pcre_trace_now() - started);
+		return rc;
+	}
+	return pcre_RegexObject_execpattern(self, subject, length, start, options, ovector, ovector_size);
+}
+
+static PyObject *
+pcre_RegexObject_match(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	char *subject;
+	int pos = INT_MIN, endpos = INT_MIN; // values of non-passed parameters
+
+	static char *kwlist[] = {"string", "pos", "endpos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s|ii", kwlist, &subject, &pos, &endpos))
+		return NULL;
+
+	// negative positions aren't accepted
+	if ((pos < 0 && pos != INT_MIN) || (endpos < 0 && endpos != INT_MIN)) {
+		Py_RETURN_NONE;
+	}
+
+	int subject_len = strlen(subject);
+	int lastindex = subject_len - 1;
 
 	if (pos > lastindex || endpos > lastindex) {
 		Py_RETURN_NONE;
@@ -291,17 +1017,17 @@ pcre_RegexObject_match(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
 	// length of substring
 	int substring_len = endpos - pos + 1;
 
-	// FIXME: jak spravne spocitat velikost vektoru???!!!
-	int ovector_size = self->groups * 3;
+	// whole match plus all groups, the last third is workspace of pcre_exec()
+	int ovector_size = (self->groups + 1) * 3;
 	int *ovector = (int*)malloc(ovector_size * sizeof(int));
 	if (ovector == NULL) {
 		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
 		return NULL;
 	}
 
-	int rc = pcre_exec(self->re, self->study, subject, substring_len, pos, 0, ovector, ovector_size);
+	int rc = pcre_RegexObject_exec(self, subject, substring_len, pos, 0, ovector, ovector_size);
 	if (rc < 0) {
-		if (rc == PCRE_ERROR_NOMATCH)
+		if (rc == REGEX_NOMATCH)
 			goto NOMATCH;
 
 		sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
@@ -349,6 +1075,1191 @@ ERROR:
 	return NULL;
 }
 
+/*
+ * Profiling of pattern positions. A shadow copy of the pattern is compiled
+ * with auto-callouts, so the callout below is invoked before every item
+ * of the pattern and counts how many times each offset was visited and
+ * how many times matching returned there by backtracking.
+ */
+
+typedef struct {
+	unsigned long *visits;
+	unsigned long *backtracks;
+	int size;
+	/* previous callout, for libraries which don't report backtracks */
+	int last_start;
+	int last_position;
+	int last_offset;
+} pcre_RegexProfile;
+
+#if !defined(USE_PCRE2) || !defined(PCRE2_CALLOUT_BACKTRACK)
+// approximation: within one match attempt, the subject position moved back,
+// or the pattern position moved back without consuming any character
+static int
+pcre_RegexProfile_backtracked(pcre_RegexProfile *profile, int offset, int start_match, int current_position)
+{
+	int backtracked = (start_match == profile->last_start &&
+					   (current_position < profile->last_position ||
+						(current_position == profile->last_position && offset <= profile->last_offset)));
+
+	profile->last_start = start_match;
+	profile->last_position = current_position;
+	profile->last_offset = offset;
+
+	return backtracked;
+}
+#endif
+
+#ifdef USE_PCRE2
+static int
+pcre_RegexObject_profile_callout(pcre2_callout_block *block, void *data)
+{
+	pcre_RegexProfile *profile = (pcre_RegexProfile *)data;
+	int offset = (int)block->pattern_position;
+
+	if (profile == NULL || offset < 0 || offset >= profile->size)
+		return 0;
+
+	profile->visits[offset]++;
+#ifdef PCRE2_CALLOUT_BACKTRACK
+	// reported since PCRE2 10.25
+	if (block->callout_flags & PCRE2_CALLOUT_BACKTRACK)
+		profile->backtracks[offset]++;
+#else
+	if (pcre_RegexProfile_backtracked(profile, offset, (int)block->start_match, (int)block->current_position))
+		profile->backtracks[offset]++;
+#endif
+
+	return 0;
+}
+#else
+static int
+pcre_RegexObject_profile_callout(pcre_callout_block *block)
+{
+	pcre_RegexProfile *profile = (pcre_RegexProfile *)block->callout_data;
+	int offset = block->pattern_position;
+
+	// the hook is global, (?C) of any other pattern calls it without profile
+	if (profile == NULL || offset < 0 || offset >= profile->size)
+		return 0;
+
+	profile->visits[offset]++;
+	if (pcre_RegexProfile_backtracked(profile, offset, block->start_match, block->current_position))
+		profile->backtracks[offset]++;
+
+	return 0;
+}
+#endif
+
+static PyObject *
+pcre_RegexObject_match_into(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	pcre_StateObject *state;
+	PyObject *subject;
+	int pos = 0, endpos = -1;
+
+	static char *kwlist[] = {"state", "string", "pos", "endpos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!S|ii", kwlist, &pcre_StateType, &state, &subject,
+			&pos, &endpos))
+		return NULL;
+
+	if (state->regex != self) {
+		PyErr_SetString(PyExc_ValueError, "MatchState belongs to another pattern.");
+		return NULL;
+	}
+
+	int rc = pcre_StateObject_match(state, subject, pos, endpos);
+	if (rc < 0)
+		return NULL;
+
+	return PyBool_FromLong(rc);
+}
+
+static PyObject *
+pcre_RegexObject_profile(pcre_RegexObject* self, PyObject *args)
+{
+	PyObject *corpus;
+
+	if (!PyArg_ParseTuple(args, "O", &corpus))
+		return NULL;
+
+	PyObject *iterator = PyObject_GetIter(corpus);
+	if (iterator == NULL)
+		return NULL;
+
+	PyObject *result = NULL;
+#ifdef USE_PCRE2
+	pcre2_code *re = NULL;
+	pcre2_match_data *match_data = NULL;
+	pcre2_match_context *match_context = NULL;
+#else
+	pcre *re = NULL;
+	pcre_extra extra;
+	int *ovector = NULL;
+#endif
+	pcre_RegexProfile profile;
+	profile.size = strlen(self->pattern) + 1; // the last callout is at the end of pattern
+	profile.visits = (unsigned long *)calloc(profile.size, sizeof(unsigned long));
+	profile.backtracks = (unsigned long *)calloc(profile.size, sizeof(unsigned long));
+	if (profile.visits == NULL || profile.backtracks == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the profile counters.");
+		goto DONE;
+	}
+
+	// shadow copy of the pattern, interpreted, because JIT doesn't report backtracks
+#ifdef USE_PCRE2
+	int errorcode;
+	PCRE2_SIZE erroffset;
+	char error[96];
+	re = pcre2_compile((PCRE2_SPTR)self->pattern, PCRE2_ZERO_TERMINATED, self->flags | PCRE2_AUTO_CALLOUT,
+					   &errorcode, &erroffset, REGEX_COMPILE_CONTEXT(self));
+	if (re == NULL) {
+		pcre2_get_error_message(errorcode, (PCRE2_UCHAR *)error, sizeof(error));
+		sprintf(message_buffer, "Pattern compilation error at offset %d: %s", (int)erroffset, error);
+		PyErr_SetString(PcreError, message_buffer);
+		goto DONE;
+	}
+
+	match_data = pcre2_match_data_create_from_pattern(re, NULL);
+	match_context = pcre2_match_context_create(NULL);
+	if (match_data == NULL || match_context == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the match data block.");
+		goto DONE;
+	}
+	pcre2_set_callout(match_context, pcre_RegexObject_profile_callout, &profile);
+#else
+	const char *error;
+	int erroffset;
+	re = pcre_compile(self->pattern, self->flags | PCRE_AUTO_CALLOUT, &error, &erroffset, REGEX_TABLES(self));
+	if (re == NULL) {
+		sprintf(message_buffer, "Pattern compilation error at offset %d: %s", erroffset, error);
+		PyErr_SetString(PcreError, message_buffer);
+		goto DONE;
+	}
+
+	int ovector_size = (self->groups + 1) * 3;
+	ovector = (int *)malloc(ovector_size * sizeof(int));
+	if (ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		goto DONE;
+	}
+
+	memset(&extra, 0, sizeof(extra));
+	extra.flags = PCRE_EXTRA_CALLOUT_DATA;
+	extra.callout_data = &profile;
+#endif
+
+	PyObject *item;
+	while ((item = PyIter_Next(iterator)) != NULL) {
+		char *subject;
+		Py_ssize_t subject_len;
+
+		if (PyString_AsStringAndSize(item, &subject, &subject_len) < 0) {
+			Py_DECREF(item);
+			goto DONE;
+		}
+
+		profile.last_start = -1;
+
+#ifdef USE_PCRE2
+		int rc = pcre2_match(re, (PCRE2_SPTR)subject, subject_len, 0, 0, match_data, match_context);
+		if (rc < 0 && rc != PCRE2_ERROR_NOMATCH) {
+#else
+		// the hook is process-wide, it is set only while no Python code can run
+		int (*previous_callout)(pcre_callout_block *) = pcre_callout;
+		pcre_callout = pcre_RegexObject_profile_callout;
+		int rc = pcre_exec(re, &extra, subject, subject_len, 0, 0, ovector, ovector_size);
+		pcre_callout = previous_callout;
+		if (rc < 0 && rc != PCRE_ERROR_NOMATCH) {
+#endif
+			sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+			PyErr_SetString(PcreError, message_buffer);
+			Py_DECREF(item);
+			goto DONE;
+		}
+
+		Py_DECREF(item);
+	}
+
+	if (PyErr_Occurred())
+		goto DONE;
+
+	// heat map as a list of (offset, visits, backtracks) for every visited offset
+	result = PyList_New(0);
+	if (result == NULL)
+		goto DONE;
+
+	for (int i = 0; i < profile.size; i++) {
+		if (profile.visits[i] == 0)
+			continue;
+
+		PyObject *entry = Py_BuildValue("(ikk)", i, profile.visits[i], profile.backtracks[i]);
+		if (entry == NULL || PyList_Append(result, entry) < 0) {
+			Py_XDECREF(entry);
+			Py_CLEAR(result);
+			goto DONE;
+		}
+		Py_DECREF(entry);
+	}
+
+DONE:
+#ifdef USE_PCRE2
+	if (match_context != NULL)
+		pcre2_match_context_free(match_context);
+	if (match_data != NULL)
+		pcre2_match_data_free(match_data);
+	if (re != NULL)
+		pcre2_code_free(re);
+#else
+	free(ovector);
+	if (re != NULL)
+		pcre_free(re);
+#endif
+	free(profile.visits);
+	free(profile.backtracks);
+	Py_DECREF(iterator);
+
+	return result;
+}
+
+/*
+ * Columnar extraction of named groups. Each match is one row, each named group
+ * one column, filled either by substrings or by (start, end) offsets.
+ */
+
+typedef struct {
+	int named;              // number of columns
+	int *groups;            // group number of each column
+	PyObject **lists;       // columns of substrings, when offsets aren't requested
+	int *offsets;           // rows x named x (start, end), when they are
+	Py_ssize_t rows;
+	Py_ssize_t capacity;
+} pcre_RegexColumns;
+
+static int
+pcre_RegexColumns_add(pcre_RegexColumns *columns, const char *subject, int *ovector, int rc)
+{
+	if (columns->lists == NULL && columns->rows == columns->capacity) {
+		columns->capacity *= 2;
+		int *resized = (int *)realloc(columns->offsets, (columns->capacity * columns->named * 2 + 1) * sizeof(int));
+		if (resized == NULL) {
+			PyErr_SetString(PcreError, "An error when allocating the offset columns.");
+			return 0;
+		}
+		columns->offsets = resized;
+	}
+
+	for (int i = 0; i < columns->named; i++) {
+		int group = columns->groups[i];
+		int start = -1, end = -1;
+
+		// row of non-matching line and unset groups are (-1, -1) or None
+		if (rc > 0 && group < rc && ovector[2 * group] >= 0) {
+			start = ovector[2 * group];
+			end = ovector[2 * group + 1];
+		}
+
+		if (columns->lists == NULL) {
+			columns->offsets[(columns->rows * columns->named + i) * 2] = start;
+			columns->offsets[(columns->rows * columns->named + i) * 2 + 1] = end;
+			continue;
+		}
+
+		PyObject *value;
+		if (start < 0) {
+			Py_INCREF(Py_None);
+			value = Py_None;
+		}
+		else {
+			value = PyString_FromStringAndSize(subject + start, end - start);
+			if (value == NULL)
+				return 0;
+		}
+
+		int failed = PyList_Append(columns->lists[i], value);
+		Py_DECREF(value);
+		if (failed)
+			return 0;
+	}
+
+	columns->rows++;
+	return 1;
+}
+
+static PyObject *
+pcre_RegexObject_columns(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	PyObject *source;
+	int offsets = 0;
+
+	static char *kwlist[] = {"source", "offsets", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|i", kwlist, &source, &offsets))
+		return NULL;
+
+	// unicode is encoded by the default encoding as the "s" format of other methods does
+	PyObject *encoded = NULL;
+	Py_buffer view;
+	int has_view = 0;
+
+	PyObject *result = NULL;
+	PyObject *names = PyDict_Keys(self->groupindex);
+	if (names == NULL)
+		return NULL;
+
+	pcre_RegexColumns columns;
+	memset(&columns, 0, sizeof(columns));
+	columns.named = (int)PyList_GET_SIZE(names);
+	columns.capacity = 64;
+
+	int ovector_size = (self->groups + 1) * 3;
+	int *ovector = (int *)malloc(ovector_size * sizeof(int));
+	columns.groups = (int *)malloc((columns.named + 1) * sizeof(int));
+	if (ovector == NULL || columns.groups == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		goto DONE;
+	}
+
+	for (int i = 0; i < columns.named; i++)
+		columns.groups[i] = (int)PyInt_AsLong(PyDict_GetItem(self->groupindex, PyList_GET_ITEM(names, i)));
+
+	if (offsets) {
+		columns.offsets = (int *)malloc((columns.capacity * columns.named * 2 + 1) * sizeof(int));
+		if (columns.offsets == NULL) {
+			PyErr_SetString(PcreError, "An error when allocating the offset columns.");
+			goto DONE;
+		}
+	}
+	else {
+		columns.lists = (PyObject **)calloc(columns.named + 1, sizeof(PyObject *));
+		if (columns.lists == NULL) {
+			PyErr_SetString(PcreError, "An error when allocating the columns.");
+			goto DONE;
+		}
+		for (int i = 0; i < columns.named; i++) {
+			columns.lists[i] = PyList_New(0);
+			if (columns.lists[i] == NULL)
+				goto DONE;
+		}
+	}
+
+	const char *subject = NULL;
+	Py_ssize_t length = 0;
+
+	if (PyUnicode_Check(source)) {
+		encoded = PyUnicode_AsEncodedString(source, NULL, NULL);
+		if (encoded == NULL)
+			goto DONE;
+		subject = PyString_AS_STRING(encoded);
+		length = PyString_GET_SIZE(encoded);
+	}
+	else if (PyObject_CheckBuffer(source)) {
+		// new buffer protocol keeps bytearray from being resized meanwhile
+		if (PyObject_GetBuffer(source, &view, PyBUF_SIMPLE) < 0)
+			goto DONE;
+		has_view = 1;
+		subject = (const char *)view.buf;
+		length = view.len;
+	}
+	else if (PyObject_CheckReadBuffer(source)) {
+		if (PyObject_AsReadBuffer(source, (const void **)&subject, &length) < 0)
+			goto DONE;
+	}
+
+	if (subject != NULL) {
+		// whole buffer, a row for every non-overlapping match
+		int pos = 0;
+
+		if (length > INT_MAX) {
+			PyErr_SetString(PyExc_ValueError, "Buffer is too large, offsets of libpcre are int.");
+			goto DONE;
+		}
+
+		while (pos <= length) {
+			int rc = pcre_RegexObject_exec(self, subject, (int)length, pos, 0, ovector, ovector_size);
+			if (rc == REGEX_NOMATCH)
+				break;
+			if (rc < 0) {
+				sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+				PyErr_SetString(PcreError, message_buffer);
+				goto DONE;
+			}
+
+			if (!pcre_RegexColumns_add(&columns, subject, ovector, rc))
+				goto DONE;
+
+			// an empty match would be found again at the same position
+			pos = (ovector[1] > ovector[0]) ? ovector[1] : ovector[1] + 1;
+		}
+	}
+	else {
+		// iterable of lines, a row for every line, so rows stay aligned with lines
+		PyObject *iterator = PyObject_GetIter(source);
+		if (iterator == NULL)
+			goto DONE;
+
+		PyObject *item;
+		while ((item = PyIter_Next(iterator)) != NULL) {
+			char *line;
+			Py_ssize_t line_length;
+
+			if (PyString_AsStringAndSize(item, &line, &line_length) < 0) {
+				Py_DECREF(item);
+				break;
+			}
+
+			int rc = pcre_RegexObject_exec(self, line, (int)line_length, 0, 0, ovector, ovector_size);
+			if (rc < 0 && rc != REGEX_NOMATCH) {
+				sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+				PyErr_SetString(PcreError, message_buffer);
+				Py_DECREF(item);
+				break;
+			}
+
+			int added = pcre_RegexColumns_add(&columns, line, ovector, rc);
+			Py_DECREF(item);
+			if (!added)
+				break;
+		}
+
+		Py_DECREF(iterator);
+		if (PyErr_Occurred())
+			goto DONE;
+	}
+
+	result = PyDict_New();
+	if (result == NULL)
+		goto DONE;
+
+	// offsets of a column are interleaved with the others, so they are gathered first
+	int *column = NULL;
+	if (offsets) {
+		column = (int *)malloc((columns.rows * 2 + 1) * sizeof(int));
+		if (column == NULL) {
+			PyErr_SetString(PcreError, "An error when allocating the offset columns.");
+			Py_CLEAR(result);
+			goto DONE;
+		}
+	}
+
+	for (int i = 0; i < columns.named; i++) {
+		PyObject *value;
+
+		if (offsets) {
+			for (Py_ssize_t row = 0; row < columns.rows; row++) {
+				column[row * 2] = columns.offsets[(row * columns.named + i) * 2];
+				column[row * 2 + 1] = columns.offsets[(row * columns.named + i) * 2 + 1];
+			}
+			value = pcre_new_int_array(column, columns.rows * 2);
+		}
+		else {
+			value = columns.lists[i];
+			Py_INCREF(value);
+		}
+
+		if (value == NULL || PyDict_SetItem(result, PyList_GET_ITEM(names, i), value) < 0) {
+			Py_XDECREF(value);
+			Py_CLEAR(result);
+			break;
+		}
+		Py_DECREF(value);
+	}
+
+	free(column);
+
+DONE:
+	if (columns.lists != NULL) {
+		for (int i = 0; i < columns.named; i++)
+			Py_XDECREF(columns.lists[i]);
+		free(columns.lists);
+	}
+	free(columns.offsets);
+	free(columns.groups);
+	free(ovector);
+	Py_DECREF(names);
+	Py_XDECREF(encoded);
+	if (has_view)
+		PyBuffer_Release(&view);
+
+	return result;
+}
+
+/*
+ * Capture-free twin of the pattern for calls which need the whole match only.
+ * It is compiled on first use with PCRE_NO_AUTO_CAPTURE, which renumbers the groups,
+ * so it can't be used when anything refers to a group by number.
+ */
+
+#ifdef USE_PCRE2
+#define REGEX_NO_AUTO_CAPTURE PCRE2_NO_AUTO_CAPTURE
+#else
+#define REGEX_NO_AUTO_CAPTURE PCRE_NO_AUTO_CAPTURE
+#endif
+
+int
+pcre_RegexObject_refersgroups(pcre_RegexObject *self)
+{
+	int backrefmax;
+	if (pcre_RegexObject_fullinfo(self, INFO_BACKREFMAX, &backrefmax) != 0 || backrefmax > 0)
+		return 1;
+
+	// subroutine calls, recursion and conditions, such as (?1), (?-1), (?R), (?&name), (?P>name), (?(1)...), \g<1>
+	for (const char *p = self->pattern; *p != '\0'; p++) {
+		if (p[0] == '\\') {
+			if (p[1] == 'g')
+				return 1;
+			if (p[1] != '\0')
+				p++; // escaped character, such as \\ or \(
+			continue;
+		}
+		if (p[0] == '(' && p[1] == '?' && p[2] != '\0' && strchr("0123456789R&(", p[2]) != NULL)
+			return 1;
+		if (p[0] == '(' && p[1] == '?' && (p[2] == '+' || p[2] == '-') && p[3] >= '0' && p[3] <= '9')
+			return 1; // but not options such as (?-i)
+		if (p[0] == '(' && p[1] == '?' && p[2] == 'P' && (p[3] == '>' || p[3] == '='))
+			return 1;
+	}
+
+	return 0;
+}
+
+static pcre_RegexObject *
+pcre_RegexObject_nocapture(pcre_RegexObject *self)
+{
+	if (self->twin != NULL)
+		return self->twin;
+	if (self->twin_state < 0)
+		return self;
+
+	self->twin_state = -1; // unless the twin is built below
+	if (self->groups == 0 || pcre_RegexObject_refersgroups(self))
+		return self;
+
+	pcre_RegexObject *twin = (pcre_RegexObject *)PyObject_CallFunction((PyObject *)&pcre_RegexType, "siiiiiiz",
+			self->pattern, self->flags | REGEX_NO_AUTO_CAPTURE, self->optimize, self->use_jit,
+			self->jit_stack_init, self->jit_stack_max, 0, (self->locale != NULL) ? self->locale->locale : NULL);
+	if (twin == NULL) {
+		PyErr_Clear(); // the original pattern still works
+		return self;
+	}
+	twin->twin_state = -1;
+	twin->owner = self;
+
+	// named groups capture anyway, nothing to gain when all groups are named
+	if (twin->groups == self->groups) {
+		Py_DECREF(twin);
+		return self;
+	}
+
+	self->twin = twin;
+	self->twin_state = 1;
+	memory_usage.twins++;
+	memory_usage.twin += twin->bytecode_size + twin->jit_size;
+
+	return twin;
+}
+
+static PyObject *
+pcre_RegexObject_test(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	char *subject;
+	int length, pos = 0;
+
+	static char *kwlist[] = {"string", "pos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|i", kwlist, &subject, &length, &pos))
+		return NULL;
+
+	if (pos < 0 || pos > length)
+		Py_RETURN_FALSE;
+
+	pcre_RegexObject *regex = pcre_RegexObject_nocapture(self);
+
+	int ovector_size = (regex->groups + 1) * 3;
+	int *ovector = (int *)malloc(ovector_size * sizeof(int));
+	if (ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		return NULL;
+	}
+
+	int rc = pcre_RegexObject_exec(regex, subject, length, pos, 0, ovector, ovector_size);
+	free(ovector);
+
+	if (rc < 0 && rc != REGEX_NOMATCH) {
+		sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+		PyErr_SetString(PcreError, message_buffer);
+		return NULL;
+	}
+
+	return PyBool_FromLong(rc >= 0);
+}
+
+static PyObject *
+pcre_RegexObject_count(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	char *subject;
+	int length, pos = 0;
+
+	static char *kwlist[] = {"string", "pos", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|i", kwlist, &subject, &length, &pos))
+		return NULL;
+
+	pcre_RegexObject *regex = pcre_RegexObject_nocapture(self);
+
+	int ovector_size = (regex->groups + 1) * 3;
+	int *ovector = (int *)malloc(ovector_size * sizeof(int));
+	if (ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		return NULL;
+	}
+
+	Py_ssize_t matches = 0;
+	int rc = 0;
+	while (pos >= 0 && pos <= length) {
+		rc = pcre_RegexObject_exec(regex, subject, length, pos, 0, ovector, ovector_size);
+		if (rc < 0)
+			break;
+		matches++;
+
+		// an empty match would be found again at the same position
+		pos = (ovector[1] > ovector[0]) ? ovector[1] : ovector[1] + 1;
+	}
+	free(ovector);
+
+	if (rc < 0 && rc != REGEX_NOMATCH) {
+		sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+		PyErr_SetString(PcreError, message_buffer);
+		return NULL;
+	}
+
+	return Py_BuildValue("n", matches);
+}
+
+/*
+ * Offsets-only iteration. Spans of selected groups of non-overlapping matches
+ * are copied from ovector straight to an int buffer, no object per match.
+ */
+
+// returns malloc'ed group numbers of the groups argument, (0,) when it is NULL
+static int *
+pcre_RegexObject_spangroups(pcre_RegexObject *self, PyObject *groups, int *count)
+{
+	if (groups == NULL) {
+		int *result = (int *)malloc(sizeof(int));
+		if (result == NULL) {
+			PyErr_SetString(PcreError, "An error when allocating groups.");
+			return NULL;
+		}
+		result[0] = 0;
+		*count = 1;
+		return result;
+	}
+
+	PyObject *sequence = PySequence_Fast(groups, "Groups must be a sequence of group numbers or names.");
+	if (sequence == NULL)
+		return NULL;
+
+	*count = (int)PySequence_Fast_GET_SIZE(sequence);
+	int *result = (int *)malloc((*count + 1) * sizeof(int));
+	if (result == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating groups.");
+		goto ERROR;
+	}
+
+	for (int i = 0; i < *count; i++) {
+		PyObject *group = PySequence_Fast_GET_ITEM(sequence, i);
+
+		if (PyString_Check(group)) {
+			group = PyDict_GetItem(self->groupindex, group); // borrowed
+			if (group == NULL) {
+				PyErr_SetString(PyExc_IndexError, "No such group.");
+				goto ERROR;
+			}
+		}
+
+		result[i] = (int)PyInt_AsLong(group);
+		if (result[i] == -1 && PyErr_Occurred())
+			goto ERROR;
+		if (result[i] < 0 || result[i] > self->groups) {
+			PyErr_SetString(PyExc_IndexError, "No such group.");
+			goto ERROR;
+		}
+	}
+
+	Py_DECREF(sequence);
+	return result;
+
+ERROR:
+	free(result);
+	Py_DECREF(sequence);
+	return NULL;
+}
+
+/*
+ * Finds up to max_matches non-overlapping matches from *pos and stores (start, end)
+ * of each of the groups into spans, unset groups as (-1, -1). Moves *pos where the
+ * next search starts, -1 when the subject is exhausted. Returns the number of matches,
+ * -1 with an exception set on error.
+ */
+static Py_ssize_t
+pcre_RegexObject_findspans(pcre_RegexObject *self, const char *subject, int length, int *pos,
+						   int *groups, int count, int *ovector, int ovector_size,
+						   int *spans, Py_ssize_t max_matches)
+{
+	Py_ssize_t matches = 0;
+
+	while (matches < max_matches) {
+		if (*pos < 0 || *pos > length) {
+			*pos = -1;
+			break;
+		}
+
+		int rc = pcre_RegexObject_exec(self, subject, length, *pos, 0, ovector, ovector_size);
+		if (rc == REGEX_NOMATCH) {
+			*pos = -1;
+			break;
+		}
+		if (rc < 0) {
+			sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+			PyErr_SetString(PcreError, message_buffer);
+			return -1;
+		}
+
+		int *span = spans + matches * count * 2;
+		for (int i = 0; i < count; i++) {
+			int group = groups[i];
+			if (group < rc && ovector[2 * group] >= 0) {
+				span[2 * i] = ovector[2 * group];
+				span[2 * i + 1] = ovector[2 * group + 1];
+			}
+			else {
+				span[2 * i] = span[2 * i + 1] = -1;
+			}
+		}
+		matches++;
+
+		// an empty match would be found again at the same position
+		*pos = (ovector[1] > ovector[0]) ? ovector[1] : ovector[1] + 1;
+	}
+
+	return matches;
+}
+
+static PyObject *
+pcre_RegexObject_spans(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	char *subject;
+	int length, pos = 0;
+	PyObject *groups_arg = NULL;
+
+	static char *kwlist[] = {"string", "pos", "groups", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|iO", kwlist, &subject, &length, &pos, &groups_arg))
+		return NULL;
+
+	int count;
+	int *groups = pcre_RegexObject_spangroups(self, groups_arg, &count);
+	if (groups == NULL)
+		return NULL;
+
+	pcre_RegexObject *regex = (groups_arg == NULL) ? pcre_RegexObject_nocapture(self) : self;
+
+	PyObject *result = NULL;
+	Py_ssize_t capacity = 64, matches = 0;
+	int ovector_size = (regex->groups + 1) * 3;
+	int *ovector = (int *)malloc(ovector_size * sizeof(int));
+	int *spans = (int *)malloc((capacity * count * 2 + 1) * sizeof(int));
+	if (ovector == NULL || spans == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the spans.");
+		goto DONE;
+	}
+
+	while (pos >= 0) {
+		if (matches == capacity) {
+			capacity *= 2;
+			int *resized = (int *)realloc(spans, (capacity * count * 2 + 1) * sizeof(int));
+			if (resized == NULL) {
+				PyErr_SetString(PcreError, "An error when allocating the spans.");
+				goto DONE;
+			}
+			spans = resized;
+		}
+
+		Py_ssize_t found = pcre_RegexObject_findspans(regex, subject, length, &pos, groups, count,
+				ovector, ovector_size, spans + matches * count * 2, capacity - matches);
+		if (found < 0)
+			goto DONE;
+		matches += found;
+	}
+
+	result = pcre_new_int_array(spans, matches * count * 2);
+
+DONE:
+	free(spans);
+	free(ovector);
+	free(groups);
+	return result;
+}
+
+static PyObject *
+pcre_RegexObject_spans_into(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	PyObject *buffer;
+	char *subject;
+	int length, pos = 0;
+	PyObject *groups_arg = NULL;
+
+	static char *kwlist[] = {"buffer", "string", "pos", "groups", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "Os#|iO", kwlist, &buffer, &subject, &length,
+			&pos, &groups_arg))
+		return NULL;
+
+	void *spans;
+	Py_ssize_t buffer_len;
+	if (PyObject_AsWriteBuffer(buffer, &spans, &buffer_len) < 0)
+		return NULL;
+
+	int count;
+	int *groups = pcre_RegexObject_spangroups(self, groups_arg, &count);
+	if (groups == NULL)
+		return NULL;
+
+	// the search would never advance without room for at least one match
+	Py_ssize_t capacity = (count > 0) ? buffer_len / (Py_ssize_t)(count * 2 * sizeof(int)) : 0;
+	if (capacity == 0) {
+		PyErr_SetString(PyExc_ValueError, "Buffer can't hold spans of one match.");
+		free(groups);
+		return NULL;
+	}
+
+	pcre_RegexObject *regex = (groups_arg == NULL) ? pcre_RegexObject_nocapture(self) : self;
+
+	PyObject *result = NULL;
+	int ovector_size = (regex->groups + 1) * 3;
+	int *ovector = (int *)malloc(ovector_size * sizeof(int));
+	if (ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		goto DONE;
+	}
+
+	Py_ssize_t matches = pcre_RegexObject_findspans(regex, subject, length, &pos, groups, count,
+			ovector, ovector_size, (int *)spans, capacity);
+	if (matches >= 0)
+		result = Py_BuildValue("(ni)", matches, pos);
+
+DONE:
+	free(ovector);
+	free(groups);
+	return result;
+}
+
+/*
+ * Matching without the GIL. Other threads can use the shared match data and JIT
+ * stack of RegexObject meanwhile, so the call gets private ones. Legacy libpcre
+ * accepts a JIT stack per call since 8.32, older JIT-compiled patterns keep the GIL.
+ */
+
+#if !defined(USE_PCRE2) && (PCRE_MAJOR > 8 || (PCRE_MAJOR == 8 && PCRE_MINOR >= 32))
+#define HAVE_PCRE_JIT_EXEC
+#endif
+
+typedef struct {
+	Py_ssize_t *offsets; // (start, end) of each group of the last match, (-1, -1) when unset
+	int nogil;
+#ifdef USE_PCRE2
+	pcre2_match_data *match_data;
+	pcre2_match_context *match_context;
+	pcre2_jit_stack *jit_stack;
+#else
+	int *ovector;
+	int ovector_size;
+	pcre_jit_stack *jit_stack;
+#endif
+} pcre_RegexPrivate;
+
+static void
+pcre_RegexPrivate_free(pcre_RegexPrivate *private)
+{
+	free(private->offsets);
+#ifdef USE_PCRE2
+	if (private->match_data != NULL)
+		pcre2_match_data_free(private->match_data);
+	if (private->match_context != NULL)
+		pcre2_match_context_free(private->match_context);
+	if (private->jit_stack != NULL)
+		pcre2_jit_stack_free(private->jit_stack);
+#else
+	free(private->ovector);
+	if (private->jit_stack != NULL)
+		pcre_jit_stack_free(private->jit_stack);
+#endif
+}
+
+static int
+pcre_RegexPrivate_init(pcre_RegexObject *self, pcre_RegexPrivate *private)
+{
+	memset(private, 0, sizeof(pcre_RegexPrivate));
+	private->nogil = 1;
+
+	private->offsets = (Py_ssize_t *)malloc((self->groups + 1) * 2 * sizeof(Py_ssize_t));
+	if (private->offsets == NULL)
+		goto ERROR;
+
+#ifdef USE_PCRE2
+	private->match_data = pcre2_match_data_create_from_pattern(self->re, NULL);
+	private->match_context = pcre2_match_context_create(NULL);
+	if (private->match_data == NULL || private->match_context == NULL)
+		goto ERROR;
+
+	if (self->jit_size > 0) {
+		private->jit_stack = pcre2_jit_stack_create(self->jit_stack_init, self->jit_stack_max, NULL);
+		if (private->jit_stack == NULL)
+			goto ERROR;
+		pcre2_jit_stack_assign(private->match_context, NULL, private->jit_stack);
+	}
+#else
+	private->ovector_size = (self->groups + 1) * 3;
+	private->ovector = (int *)malloc(private->ovector_size * sizeof(int));
+	if (private->ovector == NULL)
+		goto ERROR;
+
+#ifdef HAVE_PCRE_JIT_EXEC
+	// the pattern may have JIT code without a JIT stack of its own
+	if (self->jit_size > 0) {
+		private->jit_stack = pcre_jit_stack_alloc(self->jit_stack_init, self->jit_stack_max);
+		if (private->jit_stack == NULL)
+			goto ERROR;
+	}
+#else
+	private->nogil = (self->jit_size == 0);
+#endif
+#endif
+
+	return 1;
+
+ERROR:
+	pcre_RegexPrivate_free(private);
+	PyErr_SetString(PcreError, "An error when allocating the private match data.");
+	return 0;
+}
+
+/*
+ * The same as pcre_RegexObject_exec(), but only with private resources. Offsets are
+ * Py_ssize_t, so PCRE2 can match subjects over INT_MAX, legacy libpcre can't.
+ */
+static int
+pcre_RegexPrivate_execpattern(pcre_RegexObject *self, pcre_RegexPrivate *private, const char *subject,
+							  Py_ssize_t length, Py_ssize_t start)
+{
+	int rc;
+#ifdef USE_PCRE2
+	if (start > length)
+		rc = PCRE2_ERROR_BADOFFSET; // pcre2_jit_match() doesn't check its arguments
+	else if (self->jit_match)
+		rc = pcre2_jit_match(self->re, (PCRE2_SPTR)subject, (PCRE2_SIZE)length, (PCRE2_SIZE)start, 0,
+							 private->match_data, private->match_context);
+	else
+		rc = pcre2_match(self->re, (PCRE2_SPTR)subject, (PCRE2_SIZE)length, (PCRE2_SIZE)start, 0,
+						 private->match_data, private->match_context);
+
+	if (rc == PCRE2_ERROR_NOMATCH)
+		return REGEX_NOMATCH;
+	if (rc < 0)
+		return rc;
+
+	PCRE2_SIZE *offsets = pcre2_get_ovector_pointer(private->match_data);
+	for (int i = 0; i < (self->groups + 1) * 2; i++)
+		private->offsets[i] = (offsets[i] == PCRE2_UNSET) ? -1 : (Py_ssize_t)offsets[i];
+#else
+	int *ovector = private->ovector;
+#ifdef HAVE_PCRE_JIT_EXEC
+	if (self->study != NULL && (self->study->flags & PCRE_EXTRA_EXECUTABLE_JIT))
+		rc = pcre_jit_exec(self->re, self->study, subject, (int)length, (int)start, 0,
+						   ovector, private->ovector_size, private->jit_stack);
+	else
+#endif
+		rc = pcre_exec(self->re, self->study, subject, (int)length, (int)start, 0,
+					   ovector, private->ovector_size);
+
+	if (rc == PCRE_ERROR_NOMATCH)
+		return REGEX_NOMATCH;
+	if (rc < 0)
+		return rc;
+
+	for (int i = 0; i < (self->groups + 1) * 2; i++)
+		private->offsets[i] = (i < rc * 2) ? ovector[i] : -1;
+#endif
+	return rc;
+}
+
+static int
+pcre_RegexPrivate_exec(pcre_RegexObject *self, pcre_RegexPrivate *private, const char *subject,
+					   Py_ssize_t length, Py_ssize_t start)
+{
+	if (TRACE_MATCH_ENABLED()) {
+		PY_LONG_LONG started = pcre_trace_now();
+		int rc = pcre_RegexPrivate_execpattern(self, private, subject, length, start);
+		TRACE_MATCH(self, length, rc, pcre_trace_now() - started);
+		return rc;
+	}
+	return pcre_RegexPrivate_execpattern(self, private, subject, length, start);
+}
+
+static PyObject *
+pcre_RegexObject_mask(pcre_RegexObject* self, PyObject *args, PyObject *keywds)
+{
+	PyObject *buffer;
+	char *fill = "*";
+	int fill_len = 1;
+	PyObject *groups_arg = NULL;
+
+	static char *kwlist[] = {"buffer", "fill", "groups", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|s#O", kwlist, &buffer, &fill, &fill_len, &groups_arg))
+		return NULL;
+
+	if (fill_len == 0) {
+		PyErr_SetString(PyExc_ValueError, "Fill must not be empty.");
+		return NULL;
+	}
+
+	/*
+	 * new buffer protocol prevents bytearray from being resized without the GIL,
+	 * old one doesn't, e.g. mmap can be closed by another thread meanwhile
+	 */
+	Py_buffer view;
+	int has_view = 0;
+	char *subject;
+	Py_ssize_t length;
+
+	if (PyObject_CheckBuffer(buffer)) {
+		if (PyObject_GetBuffer(buffer, &view, PyBUF_WRITABLE) < 0)
+			return NULL;
+		has_view = 1;
+		subject = (char *)view.buf;
+		length = view.len;
+	}
+	else if (PyObject_AsWriteBuffer(buffer, (void **)&subject, &length) < 0)
+		return NULL;
+
+	PyObject *result = NULL;
+	int *groups = NULL;
+	int count;
+	pcre_RegexPrivate private;
+	memset(&private, 0, sizeof(private));
+
+#ifndef USE_PCRE2
+	if (length > INT_MAX) {
+		PyErr_SetString(PyExc_ValueError, "Buffer is too large, offsets of libpcre are int.");
+		goto DONE;
+	}
+#endif
+
+	groups = pcre_RegexObject_spangroups(self, groups_arg, &count);
+	if (groups == NULL)
+		goto DONE;
+
+	pcre_RegexObject *regex = (groups_arg == NULL) ? pcre_RegexObject_nocapture(self) : self;
+
+	if (!pcre_RegexPrivate_init(regex, &private))
+		goto DONE;
+	if (!has_view)
+		private.nogil = 0;
+
+	/*
+	 * a fill longer than one byte is checked against all the spans first, their starts
+	 * are kept meanwhile, so the buffer isn't modified when any of the lengths differs
+	 */
+	Py_ssize_t *starts = NULL;
+	Py_ssize_t starts_count = 0, starts_capacity = 0;
+
+	Py_ssize_t matches = 0, pos = 0, mismatch = -1;
+	int rc = 0, nomemory = 0;
+	long calls = 0;
+	PY_LONG_LONG scanned = 0;
+	PyThreadState *thread_state = NULL;
+
+	regex->nogil_users++;
+	if (private.nogil)
+		thread_state = PyEval_SaveThread();
+
+	while (pos <= length) {
+		rc = pcre_RegexPrivate_exec(regex, &private, subject, length, pos);
+		calls++;
+		scanned += length - pos;
+		if (rc < 0)
+			break;
+
+		Py_ssize_t *offsets = private.offsets;
+		for (int i = 0; i < count; i++) {
+			int group = groups[i];
+			if (offsets[2 * group] < 0)
+				continue;
+
+			Py_ssize_t start = offsets[2 * group], end = offsets[2 * group + 1];
+			if (fill_len == 1)
+				memset(subject + start, fill[0], end - start);
+			else if (fill_len != end - start) {
+				mismatch = start;
+				break;
+			}
+			else {
+				if (starts_count == starts_capacity) {
+					starts_capacity = (starts_capacity > 0) ? starts_capacity * 2 : 64;
+					Py_ssize_t *resized = (Py_ssize_t *)realloc(starts, starts_capacity * sizeof(Py_ssize_t));
+					if (resized == NULL) {
+						nomemory = 1;
+						break;
+					}
+					starts = resized;
+				}
+				starts[starts_count++] = start;
+			}
+		}
+		if (mismatch >= 0 || nomemory)
+			break;
+		matches++;
+
+		// an empty match would be found again at the same position
+		pos = (offsets[1] > offsets[0]) ? offsets[1] : offsets[1] + 1;
+	}
+
+	if (mismatch < 0 && !nomemory && (rc >= 0 || rc == REGEX_NOMATCH)) {
+		for (Py_ssize_t i = 0; i < starts_count; i++)
+			memcpy(subject + starts[i], fill, fill_len);
+	}
+	free(starts);
+
+	if (thread_state != NULL)
+		PyEval_RestoreThread(thread_state);
+	regex->nogil_users--;
+	pcre_RegexObject_adapt(regex, calls, scanned);
+
+	if (nomemory)
+		PyErr_SetString(PcreError, "An error when allocating the spans.");
+	else if (mismatch >= 0) {
+		sprintf(message_buffer, "Length of fill differs from the span masked at offset %ld.", (long)mismatch);
+		PyErr_SetString(PyExc_ValueError, message_buffer);
+	}
+	else if (rc < 0 && rc != REGEX_NOMATCH) {
+		sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+		PyErr_SetString(PcreError, message_buffer);
+	}
+	else
+		result = Py_BuildValue("n", matches);
+
+	pcre_RegexPrivate_free(&private);
+
+DONE:
+	free(groups);
+	if (has_view)
+		PyBuffer_Release(&view);
+	return result;
+}
+
 static PyObject *
 pcre_RegexObject_scanner(pcre_RegexObject* self)
 {
@@ -385,21 +2296,37 @@ pcre_RegexObject_subn(pcre_RegexObject* self)
 }
 
 static PyMethodDef pcre_RegexObject_methods[] = {
+	{"columns", (PyCFunction)pcre_RegexObject_columns, METH_VARARGS | METH_KEYWORDS,
+	"Return a dict of columns, one for each named group, with a row for each match in the string, unicode or other buffer, or for each string of the iterable. Columns are lists of substrings, or with offsets set array('i') of start, end pairs. Unset groups are None or -1, -1."},
+	{"count", (PyCFunction)pcre_RegexObject_count, METH_VARARGS | METH_KEYWORDS,
+	"Return the number of non-overlapping matches in string from pos."},
 	{"findall", (PyCFunction)pcre_RegexObject_findall, METH_NOARGS,
 	"Return a list of all non-overlapping matches of pattern in string."},
 	{"finditer", (PyCFunction)pcre_RegexObject_finditer, METH_NOARGS,
 	"Return an iterator over all non-overlapping matches for the RE pattern in string. For each match, the iterator returns a match object."},
+	{"mask", (PyCFunction)pcre_RegexObject_mask, METH_VARARGS | METH_KEYWORDS,
+	"Overwrite the groups (default (0,)) of every non-overlapping match in the writable buffer in place by repeated fill byte, or by fill of the same length as the span; the buffer is left intact when any span differs in length. Return the number of matches. The GIL is released meanwhile unless the buffer supports only the old buffer protocol, as mmap does, which can't keep the buffer from being closed. Legacy libpcre rejects buffers over 2 GiB, PCRE2 doesn't."},
 	{"match", (PyCFunction)pcre_RegexObject_match, METH_VARARGS | METH_KEYWORDS,
 	"Matches zero or more characters at the beginning of the string."},
+	{"match_into", (PyCFunction)pcre_RegexObject_match_into, METH_VARARGS | METH_KEYWORDS,
+	"Search string[:endpos] from pos and overwrite offsets of the MatchState of this pattern by the match. Return True when it matched, no objects are allocated."},
+	{"profile", (PyCFunction)pcre_RegexObject_profile, METH_VARARGS,
+	"Match every string of the corpus by an auto-callout copy of the pattern and return a list of (offset, visits, backtracks) for each visited offset of the pattern."},
 	{"scanner", (PyCFunction)pcre_RegexObject_scanner, METH_NOARGS, NULL},
 	{"search", (PyCFunction)pcre_RegexObject_search, METH_NOARGS,
 	"Scan through string looking for a match, and return a corresponding MatchObject instance. Return None if no position in the string matches."},
+	{"spans", (PyCFunction)pcre_RegexObject_spans, METH_VARARGS | METH_KEYWORDS,
+	"Return array('i') of start, end pairs of the groups (default (0,)) for every non-overlapping match in string from pos. Unset groups are -1, -1."},
+	{"spans_into", (PyCFunction)pcre_RegexObject_spans_into, METH_VARARGS | METH_KEYWORDS,
+	"Same as spans(), but the pairs are written as C ints into the writable buffer until it is full. Return a tuple of number of matches and the position to continue from, -1 when string is exhausted."},
 	{"split", (PyCFunction)pcre_RegexObject_split, METH_NOARGS,
 	"Split string by the occurrences of pattern."},
 	{"sub", (PyCFunction)pcre_RegexObject_sub, METH_NOARGS,
 	"Return the string obtained by replacing the leftmost non-overlapping occurrences of pattern in string by the replacement repl."},
 	{"subn", (PyCFunction)pcre_RegexObject_subn, METH_NOARGS,
 	"Return the tuple (new_string, number_of_subs_made) found by replacing the leftmost non-overlapping occurrences of pattern with the replacement repl."},
+	{"test", (PyCFunction)pcre_RegexObject_test, METH_VARARGS | METH_KEYWORDS,
+	"Return True when the pattern matches anywhere in string from pos."},
 	{NULL}  /* Sentinel */
 };
 
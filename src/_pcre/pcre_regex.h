@@ -20,9 +20,10 @@
 #define PCRE_REGEX_H
 
 #include <Python.h>
-#include <pcre.h>
 
-typedef struct {
+#include "pcre_module.h"
+
+typedef struct pcre_RegexObject {
 	PyObject_HEAD
 	/* public members */
 	char *pattern;
@@ -33,12 +34,52 @@ typedef struct {
 	int use_jit;
 	int jit_stack_init;
 	int jit_stack_max;
+	pcre_LocaleTables *locale;      // NULL for the default tables of libpcre
 	/* private members */
+	size_t bytecode_size;
+	size_t study_size;
+	size_t jit_size;
+	size_t jit_stack_size;
+	struct pcre_RegexObject *twin; // capture-free variant, built on first use
+	int twin_state;                // 0 not tried yet, 1 built, -1 not possible
+	struct pcre_RegexObject *owner; // of a twin, whose calls it counts to
+	int adaptive;                   // studied and JIT-compiled when used enough
+	long exec_calls;
+	PY_LONG_LONG exec_bytes;
+	int nogil_users;                // calls matching without the GIL, the pattern can't change meanwhile
+#ifdef USE_PCRE2
+	pcre2_code *re;
+	pcre2_match_data *match_data;       // reused by every call of match()
+	pcre2_match_context *match_context; // carries jit_stack
+	pcre2_jit_stack *jit_stack;
+	int jit_match;                      // pcre2_jit_match() can be used instead of pcre2_match()
+#else
 	pcre *re;
 	pcre_extra *study;
 	pcre_jit_stack *jit_stack;
+#endif
 } pcre_RegexObject;
 
 extern PyTypeObject pcre_RegexType;
 
+// queries pattern information by the name of PCRE_INFO_* or PCRE2_INFO_* without prefix
+#ifdef USE_PCRE2
+#define pcre_RegexObject_fullinfo(self, what, where) \
+	pcre2_pattern_info((self)->re, PCRE2_##what, (where))
+#else
+#define pcre_RegexObject_fullinfo(self, what, where) \
+	pcre_fullinfo((self)->re, (self)->study, PCRE_##what, (where))
+#endif
+
+/* return value of pcre_RegexObject_exec() when the subject doesn't match */
+#define REGEX_NOMATCH (-1)
+
+PyObject *pcre_compile_many(PyObject *module, PyObject *args, PyObject *kwds);
+
+int pcre_RegexObject_exec(pcre_RegexObject *self, const char *subject, int length, int start, int options,
+						  int *ovector, int ovector_size);
+
+// whether the pattern refers to its groups by number, so it breaks when they are renumbered
+int pcre_RegexObject_refersgroups(pcre_RegexObject *self);
+
 #endif /* PCRE_REGEX_H */
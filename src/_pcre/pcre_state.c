@@ -0,0 +1,279 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pcre_module.h"
+#include "pcre_regex.h"
+#include "pcre_state.h"
+
+static void
+pcre_StateObject_dealloc(pcre_StateObject* self)
+{
+	free(self->ovector);
+
+	Py_XDECREF(self->regex);
+	Py_XDECREF(self->subject);
+
+	self->ob_type->tp_free((PyObject*)self);
+}
+
+static int
+pcre_StateObject_init(pcre_StateObject *self, PyObject *args, PyObject *kwds)
+{
+	pcre_RegexObject *regex;
+
+	static char *kwlist[] = {"regex", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &pcre_RegexType, &regex))
+		return -1;
+
+	// whole match plus all groups, the last third is workspace of pcre_exec()
+	int *ovector = (int *)malloc((regex->groups + 1) * 3 * sizeof(int));
+	if (ovector == NULL) {
+		PyErr_SetString(PcreError, "An error when allocating the offset vector.");
+		return -1;
+	}
+
+	free(self->ovector);
+	self->ovector = ovector;
+	self->ovector_size = (regex->groups + 1) * 3;
+	self->stringcount = 0;
+
+	Py_INCREF(regex);
+	Py_XDECREF(self->regex);
+	self->regex = regex;
+
+	Py_CLEAR(self->subject);
+
+	return 0;
+}
+
+/*
+ * Matches subject[:endpos] from pos by the regex of the state and overwrites its offsets.
+ * Returns 1 on match, 0 otherwise and -1 with exception set on error.
+ */
+int
+pcre_StateObject_match(pcre_StateObject *state, PyObject *subject, int pos, int endpos)
+{
+	int length = (int)PyString_GET_SIZE(subject);
+	if (endpos < 0 || endpos > length)
+		endpos = length;
+
+	state->stringcount = 0;
+	if (subject != state->subject) {
+		Py_INCREF(subject);
+		Py_XDECREF(state->subject);
+		state->subject = subject;
+	}
+
+	if (pos < 0 || pos > endpos)
+		return 0;
+
+	int rc = pcre_RegexObject_exec(state->regex, PyString_AS_STRING(subject), endpos, pos, 0,
+								   state->ovector, state->ovector_size);
+	if (rc == REGEX_NOMATCH)
+		return 0;
+	if (rc < 0) {
+		sprintf(message_buffer, "Match execution exited with an error (code = %d).", rc);
+		PyErr_SetString(PcreError, message_buffer);
+		return -1;
+	}
+
+	state->stringcount = rc;
+	return 1;
+}
+
+// resolves group number or name, -1 with exception set when there is no such group
+static int
+pcre_StateObject_groupnumber(pcre_StateObject *self, PyObject *group)
+{
+	if (self->stringcount == 0) {
+		PyErr_SetString(PcreError, "The state doesn't hold a match.");
+		return -1;
+	}
+
+	if (group == NULL)
+		return 0;
+
+	long number;
+	if (PyInt_Check(group) || PyLong_Check(group))
+		number = PyInt_AsLong(group);
+	else {
+		PyObject *index = PyDict_GetItem(self->regex->groupindex, group); // borrowed
+		number = (index == NULL) ? -1 : PyInt_AsLong(index);
+	}
+
+	if (number < 0 || number > self->regex->groups) {
+		PyErr_SetString(PyExc_IndexError, "no such group");
+		return -1;
+	}
+	return (int)number;
+}
+
+static PyObject *
+pcre_StateObject_group(pcre_StateObject *self, PyObject *args)
+{
+	PyObject *group = NULL;
+
+	if (!PyArg_ParseTuple(args, "|O", &group))
+		return NULL;
+
+	int number = pcre_StateObject_groupnumber(self, group);
+	if (number < 0)
+		return NULL;
+
+	// groups over stringcount didn't participate in the match
+	int start = (number < self->stringcount) ? self->ovector[2 * number] : -1;
+	if (start < 0)
+		Py_RETURN_NONE;
+
+	return PyString_FromStringAndSize(PyString_AS_STRING(self->subject) + start,
+									  self->ovector[2 * number + 1] - start);
+}
+
+static PyObject *
+pcre_StateObject_offset(pcre_StateObject *self, PyObject *args, int end)
+{
+	PyObject *group = NULL;
+
+	if (!PyArg_ParseTuple(args, "|O", &group))
+		return NULL;
+
+	int number = pcre_StateObject_groupnumber(self, group);
+	if (number < 0)
+		return NULL;
+
+	if (number >= self->stringcount)
+		return PyInt_FromLong(-1);
+	return PyInt_FromLong(self->ovector[2 * number + end]);
+}
+
+static PyObject *
+pcre_StateObject_start(pcre_StateObject *self, PyObject *args)
+{
+	return pcre_StateObject_offset(self, args, 0);
+}
+
+static PyObject *
+pcre_StateObject_end(pcre_StateObject *self, PyObject *args)
+{
+	return pcre_StateObject_offset(self, args, 1);
+}
+
+static PyObject *
+pcre_StateObject_span(pcre_StateObject *self, PyObject *args)
+{
+	PyObject *group = NULL;
+
+	if (!PyArg_ParseTuple(args, "|O", &group))
+		return NULL;
+
+	int number = pcre_StateObject_groupnumber(self, group);
+	if (number < 0)
+		return NULL;
+
+	if (number >= self->stringcount)
+		return Py_BuildValue("(ii)", -1, -1);
+	return Py_BuildValue("(ii)", self->ovector[2 * number], self->ovector[2 * number + 1]);
+}
+
+static PyObject *
+pcre_StateObject_getre(pcre_StateObject *self, void *closure)
+{
+	if (self->regex == NULL)
+		Py_RETURN_NONE;
+
+	Py_INCREF(self->regex);
+	return (PyObject *)self->regex;
+}
+
+static PyObject *
+pcre_StateObject_getstring(pcre_StateObject *self, void *closure)
+{
+	if (self->subject == NULL)
+		Py_RETURN_NONE;
+
+	Py_INCREF(self->subject);
+	return self->subject;
+}
+
+static PyObject *
+pcre_StateObject_getmatched(pcre_StateObject *self, void *closure)
+{
+	return PyBool_FromLong(self->stringcount > 0);
+}
+
+static PyGetSetDef pcre_StateObject_getseters[] = {
+	{"re", (getter)pcre_StateObject_getre, NULL, NULL, NULL},
+	{"string", (getter)pcre_StateObject_getstring, NULL, NULL, NULL},
+	{"matched", (getter)pcre_StateObject_getmatched, NULL, NULL, NULL},
+	{NULL}  /* Sentinel */
+};
+
+static PyMethodDef pcre_StateObject_methods[] = {
+	{"group", (PyCFunction)pcre_StateObject_group, METH_VARARGS,
+	"Return substring of the group (number or name, default 0) of the last match, None when the group is unset."},
+	{"start", (PyCFunction)pcre_StateObject_start, METH_VARARGS,
+	"Return start offset of the group (default 0) of the last match, -1 when the group is unset."},
+	{"end", (PyCFunction)pcre_StateObject_end, METH_VARARGS,
+	"Return end offset of the group (default 0) of the last match, -1 when the group is unset."},
+	{"span", (PyCFunction)pcre_StateObject_span, METH_VARARGS,
+	"Return (start, end) of the group (default 0) of the last match, (-1, -1) when the group is unset."},
+	{NULL}  /* Sentinel */
+};
+
+PyTypeObject pcre_StateType = {
+	PyObject_HEAD_INIT(NULL)
+	0,                         /*ob_size*/
+	"_pcre.MatchState",        /*tp_name*/
+	sizeof(pcre_StateObject),  /*tp_basicsize*/
+	0,                         /*tp_itemsize*/
+	(destructor)pcre_StateObject_dealloc, /*tp_dealloc*/
+	0,                         /*tp_print*/
+	0,                         /*tp_getattr*/
+	0,                         /*tp_setattr*/
+	0,                         /*tp_compare*/
+	0,                         /*tp_repr*/
+	0,                         /*tp_as_number*/
+	0,                         /*tp_as_sequence*/
+	0,                         /*tp_as_mapping*/
+	0,                         /*tp_hash */
+	0,                         /*tp_call*/
+	0,                         /*tp_str*/
+	0,                         /*tp_getattro*/
+	0,                         /*tp_setattro*/
+	0,                         /*tp_as_buffer*/
+	Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+	"MatchState(regex) holds offsets of the last RegexObject.match_into() of regex, reused by every call", /* tp_doc */
+	0,		                   /* tp_traverse */
+	0,		                   /* tp_clear */
+	0,		                   /* tp_richcompare */
+	0,		                   /* tp_weaklistoffset */
+	0,		                   /* tp_iter */
+	0,		                   /* tp_iternext */
+	pcre_StateObject_methods,  /* tp_methods */
+	0,                         /* tp_members */
+	pcre_StateObject_getseters,/* tp_getset */
+	0,                         /* tp_base */
+	0,                         /* tp_dict */
+	0,                         /* tp_descr_get */
+	0,                         /* tp_descr_set */
+	0,                         /* tp_dictoffset */
+	(initproc)pcre_StateObject_init, /* tp_init */
+	0,                         /* tp_alloc */
+	PyType_GenericNew,         /* tp_new */
+};
@@ -0,0 +1,41 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PCRE_STATE_H
+#define PCRE_STATE_H
+
+#include <Python.h>
+
+#include "pcre_regex.h"
+
+typedef struct {
+	PyObject_HEAD
+	/* public members */
+	pcre_RegexObject *regex;
+	PyObject *subject;  // of the last match_into(), referenced instead of copied
+	/* private members */
+	int *ovector;       // sized for all groups of regex once for all matches
+	int ovector_size;
+	int stringcount;    // 0 when the last match_into() didn't match
+} pcre_StateObject;
+
+extern PyTypeObject pcre_StateType;
+
+int pcre_StateObject_match(pcre_StateObject *state, PyObject *subject, int pos, int endpos);
+
+#endif /* PCRE_STATE_H */
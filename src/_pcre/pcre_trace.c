@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <Python.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pcre_trace.h"
+
+#ifdef USE_USDT
+// set by a tracer attaching to the probe, the section is where sys/sdt.h looks for them
+unsigned short pcre_compile_semaphore __attribute__((section(".probes")));
+unsigned short pcre_match_semaphore __attribute__((section(".probes")));
+#endif
+
+/*
+ * perf map of JIT code, perf report reads /tmp/perf-<pid>.map to name anonymous code.
+ * Lines are "<start> <size> <name>" in hex and they are only appended, the map of
+ * a forked process is started anew.
+ */
+
+int perf_map_enabled;
+static FILE *perf_map_file;
+static pid_t perf_map_pid;
+static char perf_map_path[64];
+
+static void
+pcre_perf_map_close(void)
+{
+	if (perf_map_file != NULL)
+		fclose(perf_map_file);
+	perf_map_file = NULL;
+}
+
+static FILE *
+pcre_perf_map_open(void)
+{
+	pid_t pid = getpid();
+
+	if (perf_map_file != NULL && perf_map_pid == pid)
+		return perf_map_file;
+
+	pcre_perf_map_close();
+	sprintf(perf_map_path, "/tmp/perf-%d.map", (int)pid);
+	perf_map_file = fopen(perf_map_path, "a");
+	perf_map_pid = pid;
+
+	return perf_map_file;
+}
+
+void
+pcre_perf_map_add(const void *start, size_t size, const char *pattern)
+{
+	if (!perf_map_enabled || start == NULL || size == 0)
+		return;
+
+	FILE *file = pcre_perf_map_open();
+	if (file == NULL)
+		return;
+
+	// the name is the rest of line, so the pattern is cut at a line break
+	fprintf(file, "%lx %lx pcre:%.*s\n", (unsigned long)start, (unsigned long)size,
+			(int)strcspn(pattern, "\r\n"), pattern);
+	fflush(file);
+}
+
+PyObject *
+pcre_perf_map(PyObject *module, PyObject *args)
+{
+	int enable = 1;
+
+	if (!PyArg_ParseTuple(args, "|i", &enable))
+		return NULL;
+
+	perf_map_enabled = enable;
+	if (!enable) {
+		pcre_perf_map_close();
+		Py_RETURN_NONE;
+	}
+
+	if (pcre_perf_map_open() == NULL) {
+		perf_map_enabled = 0;
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, perf_map_path);
+	}
+
+	return Py_BuildValue("s", perf_map_path);
+}
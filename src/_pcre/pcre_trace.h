@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2012, Jakub Matys <matys.jakub@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 2 of the License,
+ *  or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PCRE_TRACE_H
+#define PCRE_TRACE_H
+
+#include "pcre_module.h"
+
+#include <time.h>
+
+/*
+ * Static tracepoints for perf, bpftrace and SystemTap, built by setup.py --with-usdt:
+ *   pcre:compile(regex, pattern, ok, nanoseconds)
+ *   pcre:match(regex, subject length, rc, nanoseconds)
+ * regex is the address of RegexObject, which ties match probes to the compile one
+ * with the pattern. Timing is done only when a tracer has enabled the probe by its
+ * semaphore.
+ */
+#ifdef USE_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+extern unsigned short pcre_compile_semaphore;
+extern unsigned short pcre_match_semaphore;
+
+#define TRACE_COMPILE_ENABLED() __builtin_expect(pcre_compile_semaphore, 0)
+#define TRACE_COMPILE(regex, pattern, ok, ns) STAP_PROBE4(pcre, compile, regex, pattern, ok, ns)
+#define TRACE_MATCH_ENABLED() __builtin_expect(pcre_match_semaphore, 0)
+#define TRACE_MATCH(regex, length, rc, ns) STAP_PROBE4(pcre, match, regex, length, rc, ns)
+#else
+#define TRACE_COMPILE_ENABLED() 0
+#define TRACE_COMPILE(regex, pattern, ok, ns) ((void)(ns))
+#define TRACE_MATCH_ENABLED() 0
+#define TRACE_MATCH(regex, length, rc, ns) ((void)(ns))
+#endif
+
+static inline PY_LONG_LONG
+pcre_trace_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (PY_LONG_LONG)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+extern int perf_map_enabled;
+
+PyObject *pcre_perf_map(PyObject *module, PyObject *args);
+void pcre_perf_map_add(const void *start, size_t size, const char *pattern);
+
+#endif /* PCRE_TRACE_H */
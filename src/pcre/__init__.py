@@ -19,6 +19,7 @@
 
 
 import sys
+import locale
 import sre_compile
 
 import re
@@ -28,14 +29,14 @@ import _pcre
 __all__ = [ "match", "search", "sub", "subn", "split", "findall",
     "compile", "purge", "template", "escape", "I", "L", "M", "S", "X",
     "U", "IGNORECASE", "LOCALE", "MULTILINE", "DOTALL", "VERBOSE",
-    "UNICODE", "error", "finditer" ]
+    "UNICODE", "error", "finditer", "compile_many" ]
 
 __version__ = "0.1"
 
-# TODO: fix LOCALE,UNICODE,VERBOSE
+# TODO: fix UNICODE,VERBOSE
 # flags
 I = IGNORECASE = _pcre.PCRE_CASELESS # ignore case
-L = LOCALE = sre_compile.SRE_FLAG_LOCALE # assume current 8-bit locale
+L = LOCALE = 1 << 32 # assume current 8-bit locale, out of range of libpcre options
 U = UNICODE = sre_compile.SRE_FLAG_UNICODE # assume unicode locale
 M = MULTILINE = _pcre.PCRE_MULTILINE # make anchors look for newline
 S = DOTALL = _pcre.PCRE_DOTALL # make dot match newline
@@ -103,6 +104,13 @@ def compile(pattern, flags=0):
     "Compile a regular expression pattern, returning a pattern object."
     return _compile(pattern, flags)
 
+def compile_many(specs, threads=0):
+    """Compile a sequence of patterns, or tuples of RegexObject arguments,
+    in parallel by native threads, one per CPU when threads is 0.
+    Return a list of pattern objects in the order of specs, with an
+    error instance in place of each pattern which failed to compile."""
+    return _pcre.compile_many([_compile_spec(spec) for spec in specs], threads)
+
 def purge():
     "Clear the regular expression cache"
     _cache.clear()
@@ -132,13 +140,27 @@ _cache = {}
 
 _MAXCACHE = 100
 
+# RegexObject arguments after the pattern, to complete a spec up to the locale
+_spec_defaults = (0, 0, 0, _pcre.JIT_STACK_INIT_SIZE, _pcre.JIT_STACK_MAX_SIZE, 0, None)
+
+def _compile_spec(spec):
+    # internal: turn LOCALE of a compile_many() spec into the tables of the current locale
+    if not isinstance(spec, tuple) or len(spec) < 2 or \
+            not isinstance(spec[1], (int, long)) or not spec[1] & LOCALE:
+        return spec
+    args = spec[1:] + _spec_defaults[len(spec) - 1:]
+    ctype = args[6] if args[6] is not None else locale.setlocale(locale.LC_CTYPE)
+    return (spec[0], args[0] & ~LOCALE) + args[1:6] + (ctype,) + args[7:]
+
 def _compile(*key):
     # internal: compile pattern
-    cachekey = (type(key[0]),) + key
+    pattern, flags = key
+    # character tables are built for the locale once and shared by its patterns
+    ctype = locale.setlocale(locale.LC_CTYPE) if flags & LOCALE else None
+    cachekey = (type(pattern),) + key + (ctype,)
     p = _cache.get(cachekey)
     if p is not None:
         return p
-    pattern, flags = key
     if isinstance(pattern, _pcre.RegexObject):
         if flags:
             raise ValueError('Cannot process flags argument with a compiled pattern')
@@ -146,7 +168,7 @@ def _compile(*key):
     if not sre_compile.isstring(pattern):
         raise TypeError('First argument must be string or compiled pattern')
     try:
-        p = _pcre.RegexObject(pattern, flags)
+        p = _pcre.RegexObject(pattern, flags & ~LOCALE, locale=ctype)
     except error, v:
         raise error, v # invalid expression
     if len(_cache) >= _MAXCACHE:
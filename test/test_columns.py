@@ -0,0 +1,53 @@
+import unittest
+import pcre
+
+class TestColumns(unittest.TestCase):
+    def setUp(self):
+        pattern = r'(?<ip>\d+\.\d+\.\d+\.\d+) (?<method>[A-Z]+) (?<path>\S+)(?: (?<status>\d+))?'
+        self.regex = pcre.compile(pattern)
+        self.lines = ['10.0.0.1 GET /index.html 200',
+                      'garbage',
+                      '10.0.0.2 POST /form']
+
+    def test_lines(self):
+        columns = self.regex.columns(self.lines)
+        self.assertEquals(['ip', 'method', 'path', 'status'], sorted(columns))
+        self.assertEquals(['10.0.0.1', None, '10.0.0.2'], columns['ip'])
+        self.assertEquals(['GET', None, 'POST'], columns['method'])
+        self.assertEquals(['200', None, None], columns['status'])
+
+    def test_buffer(self):
+        columns = self.regex.columns('\n'.join(self.lines))
+        self.assertEquals(['/index.html', '/form'], columns['path'])
+        self.assertEquals(['200', None], columns['status'])
+
+    def test_unicode(self):
+        columns = self.regex.columns(u'\n'.join(self.lines))
+        self.assertEquals(['/index.html', '/form'], columns['path'])
+        self.assertRaises(UnicodeError, self.regex.columns, u'10.0.0.1 GET /\xe9')
+
+    def test_other_buffers(self):
+        text = '\n'.join(self.lines)
+        for source in (bytearray(text), buffer(text)):
+            columns = self.regex.columns(source)
+            self.assertEquals(['/index.html', '/form'], columns['path'])
+            self.assertEquals(['200', None], columns['status'])
+
+    def test_offsets(self):
+        buf = '\n'.join(self.lines)
+        columns = self.regex.columns(buf, offsets=True)
+        path = columns['path']
+        self.assertEquals('i', path.typecode)
+        self.assertEquals('/index.html', buf[path[0]:path[1]])
+        self.assertEquals('/form', buf[path[2]:path[3]])
+        self.assertEquals([25, 28, -1, -1], columns['status'].tolist())
+
+    def test_many_rows(self):
+        columns = self.regex.columns(self.lines * 100, offsets=True)
+        self.assertEquals(600, len(columns['ip']))
+
+    def test_no_named_groups(self):
+        self.assertEquals({}, pcre.compile(r'\d+').columns('1 2 3'))
+
+if __name__ == '__main__':
+    unittest.main()
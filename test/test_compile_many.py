@@ -0,0 +1,34 @@
+import unittest
+import pcre
+
+class TestCompileMany(unittest.TestCase):
+    def test_order(self):
+        patterns = [r'a%d(\d+)' % i for i in range(200)]
+        regexes = pcre.compile_many(patterns, threads=4)
+        self.assertEquals(patterns, [regex.pattern for regex in regexes])
+        self.assertEquals('7', regexes[5].match('xa57').group(1))
+
+    def test_errors(self):
+        regexes = pcre.compile_many([r'\d+', r'(', (r'x', 'bad flags'), r'[a-z]+'])
+        self.assertTrue(isinstance(regexes[0], pcre._pcre.RegexObject))
+        self.assertTrue(isinstance(regexes[1], pcre.error))
+        self.assertTrue(isinstance(regexes[2], TypeError))
+        self.assertTrue(isinstance(regexes[3], pcre._pcre.RegexObject))
+
+    def test_arguments(self):
+        regexes = pcre.compile_many([(r'abc', pcre.I), (r'\w+', 0, 1)], threads=1)
+        self.assertEquals(pcre.I, regexes[0].flags)
+        self.assertTrue(regexes[0].test('ABC'))
+        self.assertTrue(regexes[1].optimized)
+
+    def test_jit(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        regexes = pcre.compile_many([(r'(\w+)@(\w+)\.com', 0, 1, 1)] * 50)
+        self.assertTrue(all(regex.jit_compiled for regex in regexes))
+
+    def test_empty(self):
+        self.assertEquals([], pcre.compile_many([]))
+
+if __name__ == '__main__':
+    unittest.main()
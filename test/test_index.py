@@ -0,0 +1,98 @@
+import unittest
+import pcre
+
+RegexObject = pcre._pcre.RegexObject
+PatternIndex = pcre._pcre.PatternIndex
+
+PATTERNS = [
+    r'ERROR \d+',
+    r'(?i)warning: (\w+)',
+    r'^GET /',
+    r'[xyz]+\d',
+    r'\d+ ms$',
+    r'(?m)^#',
+    r'a*',
+    r'user=(\w+)',
+    r'(?i)\xc4',
+    r'(?<=k)ey',
+    r'(?:cat|dog)s?',
+]
+
+LINES = [
+    'ERROR 42 in module',
+    'Warning: disk full',
+    'WARNING: disk full',
+    'GET /index.html',
+    'POST /GET /',
+    'request took 15 ms',
+    'comment\n# line',
+    'x1 y2',
+    'user=admin key=1',
+    '\xc4\xe4',
+    'hot dogs',
+    '',
+    'nothing to see',
+]
+
+class TestPatternIndex(unittest.TestCase):
+    def setUp(self):
+        self.regexes = [RegexObject(p) for p in PATTERNS]
+        self.index = PatternIndex(self.regexes)
+
+    def matching(self, line, pos=0):
+        return [i for i, regex in enumerate(self.regexes) if regex.test(line, pos)]
+
+    def test_patterns(self):
+        self.assertEquals(tuple(self.regexes), self.index.patterns)
+
+    def test_candidates_cover_matches(self):
+        for line in LINES:
+            for pos in range(len(line) + 1):
+                candidates = self.index.candidates(line, pos)
+                for i in self.matching(line, pos):
+                    self.assertTrue(i in candidates, (PATTERNS[i], line, pos))
+
+    def test_search(self):
+        for line in LINES:
+            self.assertEquals(self.matching(line), self.index.search(line))
+
+    def test_selective(self):
+        candidates = self.index.candidates('no hits')
+        self.assertFalse(0 in candidates)    # no 'E' in any case
+        self.assertFalse(2 in candidates)    # doesn't start by 'G'
+        self.assertFalse(3 in candidates)    # no x, y or z
+        self.assertTrue(6 in candidates)     # matches empty
+        self.assertTrue(len(candidates) < len(PATTERNS))
+
+    def test_locale_caseless(self):
+        regexes = [RegexObject(r'(?i)warning', locale='C'), RegexObject(r'(?i)k\d', locale='C')]
+        index = PatternIndex(regexes)
+        self.assertEquals([0, 1], index.search('WARNING K1'))
+        self.assertEquals([], index.candidates('nothing'))
+
+    def test_anchored_at_pos(self):
+        self.assertTrue(2 in self.index.candidates('GET /'))
+        self.assertFalse(2 in self.index.candidates('POST /GET /'))
+
+    def test_min_length(self):
+        regex = RegexObject(r'\w{5}', 0, 1)
+        index = PatternIndex([regex])
+        self.assertEquals([], index.candidates('abcd'))
+        self.assertEquals([0], index.candidates('abcde'))
+
+    def test_many_patterns(self):
+        regexes = [RegexObject(r'key%d=\d' % i, 0, 1) for i in range(200)]
+        index = PatternIndex(regexes)
+        self.assertEquals([], index.candidates('nothing here'))
+        self.assertEquals([130], index.search('a key130=1'))
+
+    def test_empty(self):
+        index = PatternIndex([])
+        self.assertEquals([], index.candidates('abc'))
+        self.assertEquals(0, index.unfiltered)
+
+    def test_not_regex(self):
+        self.assertRaises(TypeError, PatternIndex, ['abc'])
+
+if __name__ == '__main__':
+    unittest.main()
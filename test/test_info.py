@@ -0,0 +1,56 @@
+import unittest
+import pcre
+
+class TestPatternInfo(unittest.TestCase):
+    def setUp(self):
+        self.regex = pcre.compile(r'^ab(c)\d+\1x')
+
+    def test_bytecode_size(self):
+        self.assertTrue(self.regex.bytecode_size > 0)
+
+    def test_min_length(self):
+        self.assertTrue(self.regex.min_length in (-1, 6))
+
+    def test_anchored(self):
+        self.assertTrue(self.regex.anchored)
+        self.assertFalse(pcre.compile(r'ab').anchored)
+
+    def test_first_byte(self):
+        self.assertEquals(ord('a'), pcre.compile(r'ab').first_byte)
+        self.assertEquals(-2, pcre.compile(r'[ab]').first_byte)
+
+    def test_required_byte(self):
+        self.assertEquals(ord('x'), self.regex.required_byte)
+        self.assertEquals(-1, pcre.compile(r'a').required_byte)
+
+    def test_backref_max(self):
+        self.assertEquals(1, self.regex.backref_max)
+        self.assertEquals(0, pcre.compile(r'a').backref_max)
+
+    def test_not_jit_compiled(self):
+        self.assertFalse(self.regex.jit_compiled)
+        self.assertEquals(0, self.regex.jit_size)
+
+class TestMemoryUsage(unittest.TestCase):
+    def test_totals(self):
+        before = pcre._pcre.memory_usage()
+        regex = pcre._pcre.RegexObject(r'(\w+)@(\w+)\.com')
+        after = pcre._pcre.memory_usage()
+        self.assertEquals(before['patterns'] + 1, after['patterns'])
+        self.assertEquals(before['bytecode'] + regex.bytecode_size, after['bytecode'])
+        del regex
+        self.assertEquals(before, pcre._pcre.memory_usage())
+
+    def test_jit(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        before = pcre._pcre.memory_usage()
+        regex = pcre._pcre.RegexObject(r'(\w+)@(\w+)\.com', 0, 1, 1)
+        after = pcre._pcre.memory_usage()
+        self.assertTrue(regex.jit_compiled)
+        self.assertEquals(before['jit_patterns'] + 1, after['jit_patterns'])
+        self.assertEquals(before['jit_code'] + regex.jit_size, after['jit_code'])
+        self.assertEquals(before['jit_stack'] + pcre._pcre.JIT_STACK_MAX_SIZE, after['jit_stack'])
+
+if __name__ == '__main__':
+    unittest.main()
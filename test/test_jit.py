@@ -0,0 +1,43 @@
+import unittest
+import pcre
+
+class TestJit(unittest.TestCase):
+    def setUp(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        pattern = r'(?<date>(?<year>(\d\d)?\d\d) - (?<month>\d\d) - (?<day>\d\d))'
+        self.regex = pcre._pcre.RegexObject(pattern, 0, 1, 1)
+
+    def test_use_jit(self):
+        self.assertTrue(self.regex.use_jit)
+        self.assertTrue(self.regex.optimized)
+
+    def test_match(self):
+        match = self.regex.match('2012 - 01 - 01')
+        self.assertTrue(match)
+        self.assertEquals('2012', match.group(2))
+        self.assertEquals(('01', '01'), match.group(4, 5))
+
+    def test_nomatch(self):
+        match = self.regex.match('some text')
+        self.assertFalse(match)
+
+    def test_jit_without_optimize(self):
+        self.assertRaises(pcre.error, pcre._pcre.RegexObject, r'\d+', 0, 0, 1)
+
+    def test_start_past_end(self):
+        for optimize, use_jit in ((0, 0), (1, 0), (1, 1)):
+            regex = pcre._pcre.RegexObject(r'x*', 0, optimize, use_jit)
+            self.assertRaises(pcre.error, regex.match, 'abcdefgh', 6, 6)
+            self.assertEquals('', regex.match('abcdefgh', 0, 3).group(0))
+
+    def test_invalid_utf(self):
+        invalid = '\xff\xfe\x80abc'
+        for regex in (pcre._pcre.RegexObject(r'\w+', pcre._pcre.PCRE_UTF8, 1, 1),
+                      pcre._pcre.RegexObject(r'(*UTF)\w+', 0, 1, 1)):
+            self.assertRaises(pcre.error, regex.match, invalid)
+            self.assertRaises(pcre.error, regex.mask, bytearray(invalid))
+            self.assertEquals('abc', regex.match('abc').group())
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,94 @@
+import os
+import sys
+import timeit
+import unittest
+import pcre
+
+_pcre = pcre._pcre
+
+# latency budgets in milliseconds, a case fails when any of them is exceeded; the slowest
+# case takes about 15 ms (p50) on a desktop, the defaults leave room for slow or loaded
+# machines and catch exponential blow-ups only, CI can tighten them by the variables
+BUDGET_P50 = float(os.environ.get('PCRE_LATENCY_P50', 50))
+BUDGET_P99 = float(os.environ.get('PCRE_LATENCY_P99', 200))
+BUDGET_MAX = float(os.environ.get('PCRE_LATENCY_MAX', 1000))
+# time to hit the match limit of a runaway match
+BUDGET_LIMIT = float(os.environ.get('PCRE_LATENCY_LIMIT', 5000))
+
+# enough samples for p99 to differ from the maximum
+ROUNDS = int(os.environ.get('PCRE_LATENCY_ROUNDS', 100))
+
+# (pattern, subject), backtracking-prone patterns with inputs that make them fail late
+CORPUS = [
+    (r'(a+)+$', 'a' * 16 + 'b'),
+    (r'(a|aa)+$', 'a' * 20 + 'b'),
+    (r'(a|a?)+$', 'a' * 14 + 'b'),
+    (r'(\w+\s?)+$', 'word ' * 5 + '!'),
+    (r'^(\d+)*[a-z]$', '1' * 16 + '!'),
+    (r'(x+x+)+y', 'x' * 16 + 'z' + 'y'),
+    (r'^(\w|\s)*$', 'ab ' * 300 + '!'),
+    (r'^(([a-z])+.)+[A-Z]([a-z])+$', 'a' * 16 + '!'),
+]
+
+# (name, optimize, use_jit), studying without JIT changes nothing under PCRE2
+MODES = [('interpreted', 0, 0)]
+if _pcre.backend() == 'pcre':
+    MODES.append(('studied', 1, 0))
+if _pcre.jit_enabled():
+    MODES.append(('jit', 1, 1))
+
+def percentile(samples, q):
+    samples = sorted(samples)
+    return samples[int(round(q * (len(samples) - 1)))]
+
+def run(regex, subject):
+    start = timeit.default_timer()
+    try:
+        regex.match(subject)
+    except pcre.error:
+        pass # hitting a match limit is a bounded outcome too
+    return (timeit.default_timer() - start) * 1000
+
+class TestLatency(unittest.TestCase):
+    report = []
+
+    @classmethod
+    def tearDownClass(cls):
+        sys.stderr.write('\n%-30s %-12s %9s %9s %9s\n' % ('pattern', 'mode', 'p50 ms', 'p99 ms', 'max ms'))
+        for pattern, mode, p50, p99, worst in cls.report:
+            sys.stderr.write('%-30s %-12s %9.3f %9.3f %9.3f\n' % (pattern, mode, p50, p99, worst))
+
+    def test_corpus(self):
+        for pattern, subject in CORPUS:
+            for mode, optimize, use_jit in MODES:
+                regex = _pcre.RegexObject(pattern, 0, optimize, use_jit)
+                samples = [run(regex, subject) for i in range(ROUNDS)]
+                p50, p99, worst = percentile(samples, 0.5), percentile(samples, 0.99), max(samples)
+                self.report.append((pattern, mode, p50, p99, worst))
+
+                case = '%s (%s)' % (pattern, mode)
+                self.assertTrue(p50 <= BUDGET_P50, '%s: p50 %.3f ms over budget' % (case, p50))
+                self.assertTrue(p99 <= BUDGET_P99, '%s: p99 %.3f ms over budget' % (case, p99))
+                self.assertTrue(worst <= BUDGET_MAX, '%s: max %.3f ms over budget' % (case, worst))
+
+class TestLimits(unittest.TestCase):
+    def test_match_limit(self):
+        # exponential backtracking is stopped by the default match limit of libpcre
+        for mode, optimize, use_jit in MODES:
+            regex = _pcre.RegexObject(r'(a+)+$', 0, optimize, use_jit)
+            start = timeit.default_timer()
+            self.assertRaises(pcre.error, regex.match, 'a' * 40 + 'b')
+            elapsed = (timeit.default_timer() - start) * 1000
+            self.assertTrue(elapsed <= BUDGET_LIMIT, '%s: match limit hit after %.3f ms' % (mode, elapsed))
+
+    def test_jit_stack_limit(self):
+        if not _pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        subject = 'ab ' * 20000 + '!'
+        small = _pcre.RegexObject(r'^(\w|\s)*$', 0, 1, 1, 32 * 1024, 32 * 1024)
+        self.assertRaises(pcre.error, small.match, subject)
+        large = _pcre.RegexObject(r'^(\w|\s)*$', 0, 1, 1, 32 * 1024, 8 * 1024 * 1024)
+        self.assertEquals(None, large.match(subject))
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,59 @@
+import unittest
+import pcre
+
+class TestLexer(unittest.TestCase):
+    def setUp(self):
+        rules = [('number', r'(\d+)(\.\d+)?'), ('name', r'[a-z]+'),
+                 ('op', r'[-+*/=]'), ('space', r'\s+')]
+        self.lexer = pcre._pcre.Lexer(rules)
+
+    def test_names(self):
+        self.assertEquals(('number', 'name', 'op', 'space'), self.lexer.names)
+
+    def test_scan(self):
+        tokens, pos = self.lexer.scan('x = 3.14')
+        self.assertEquals(8, pos)
+        self.assertEquals([(1, 0, 1), (3, 1, 2), (2, 2, 3), (3, 3, 4), (0, 4, 8)], tokens)
+
+    def test_scan_stops(self):
+        tokens, pos = self.lexer.scan('ab ? cd')
+        self.assertEquals([(1, 0, 2), (3, 2, 3)], tokens)
+        self.assertEquals(3, pos)
+
+    def test_scan_pos(self):
+        tokens, pos = self.lexer.scan('x = 1', 4)
+        self.assertEquals([(0, 4, 5)], tokens)
+
+    def test_scan_array(self):
+        tokens, pos = self.lexer.scan_array('a+1')
+        self.assertEquals('i', tokens.typecode)
+        self.assertEquals([1, 0, 1, 2, 1, 2, 0, 2, 3], tokens.tolist())
+        self.assertEquals(3, pos)
+
+    def test_empty_match(self):
+        lexer = pcre._pcre.Lexer([('maybe', r'a*')])
+        self.assertRaises(pcre.error, lexer.scan, 'b')
+
+    def test_invalid_rule(self):
+        self.assertRaises(TypeError, pcre._pcre.Lexer, ['abc'])
+        self.assertRaises(pcre.error, pcre._pcre.Lexer, [('bad', '(')])
+
+    def test_group_references(self):
+        self.assertRaises(pcre.error, pcre._pcre.Lexer, [('quoted', r'(["\'])[^"\']*\1'), ('space', r'\s+')])
+        self.assertRaises(pcre.error, pcre._pcre.Lexer, [('nested', r'\((?:[^()]|(?R))*\)')])
+        self.assertRaises(pcre.error, pcre._pcre.Lexer, [('again', r'(a)(?1)')])
+        lexer = pcre._pcre.Lexer([('word', r'(?i)a(?-i)b'), ('space', r'\s+')])
+        self.assertEquals(([(0, 0, 2), (1, 2, 3), (0, 3, 5)], 5), lexer.scan('Ab ab'))
+
+    def test_extended_comment(self):
+        lexer = pcre._pcre.Lexer([('number', r'(?x) \d+  # digits'), ('space', r'\s+')])
+        self.assertEquals(([(0, 0, 2), (1, 2, 3), (0, 3, 4)], 4), lexer.scan('12 3'))
+        lexer = pcre._pcre.Lexer([('number', r'\d+ # digits'), ('space', r'\s+')], pcre._pcre.PCRE_EXTENDED)
+        self.assertEquals(([(0, 0, 2), (1, 2, 3)], 3), lexer.scan('12 x'))
+
+    def test_duplicate_names(self):
+        lexer = pcre._pcre.Lexer([('number', r'(?P<value>\d+)'), ('name', r'(?P<value>[a-z]+)')])
+        self.assertEquals(([(1, 0, 2), (0, 2, 4)], 4), lexer.scan('ab12'))
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,71 @@
+import locale
+import unittest
+import pcre
+
+RegexObject = pcre._pcre.RegexObject
+
+# a Latin-1 locale, where \xc4 and \xe4 are upper and lower case of one letter
+LATIN1 = None
+for name in ('de_DE.ISO-8859-1', 'de_DE.iso88591', 'de_DE', 'en_US.ISO-8859-1'):
+    try:
+        RegexObject('a', locale=name)
+        LATIN1 = name
+        break
+    except pcre.error:
+        pass
+
+class TestLocale(unittest.TestCase):
+    def test_default_tables(self):
+        self.assertEquals(None, RegexObject('a').locale)
+
+    def test_shared_tables(self):
+        first = RegexObject(r'\w+', locale='C')
+        second = RegexObject(r'\d+', locale='C')
+        self.assertEquals('C', first.locale)
+        self.assertEquals('C', second.locale)
+        self.assertEquals(1, pcre._pcre.locales().count('C'))
+
+    def test_current_locale(self):
+        current = locale.setlocale(locale.LC_CTYPE)
+        self.assertEquals(current, RegexObject('a', locale='').locale)
+
+    def test_unsupported_locale(self):
+        self.assertRaises(pcre.error, RegexObject, 'a', locale='xx_NOWHERE.none')
+
+    def test_flag(self):
+        regex = pcre.compile(r'(?i)abc', pcre.LOCALE)
+        self.assertEquals(locale.setlocale(locale.LC_CTYPE), regex.locale)
+        self.assertTrue(regex.match('ABC'))
+        self.assertFalse(regex.flags & pcre.LOCALE)
+
+    def test_flag_doesnt_clash(self):
+        # sre value of LOCALE is PCRE_DOTALL of legacy libpcre
+        self.assertFalse(pcre.compile(r'a.b', pcre.LOCALE).test('a\nb'))
+
+    def test_cache_keyed_by_locale(self):
+        self.assertTrue(pcre.compile(r'x', pcre.LOCALE) is pcre.compile(r'x', pcre.LOCALE))
+        self.assertFalse(pcre.compile(r'x', pcre.LOCALE) is pcre.compile(r'x'))
+
+    def test_compile_many_flag(self):
+        current = locale.setlocale(locale.LC_CTYPE)
+        regexes = pcre.compile_many([(r'(?i)abc', pcre.L), (r'\w+', pcre.L | pcre.I, 1), r'x'])
+        self.assertTrue(all(isinstance(regex, RegexObject) for regex in regexes))
+        self.assertEquals([current, current, None], [regex.locale for regex in regexes])
+        self.assertEquals(pcre.I, regexes[1].flags)
+        self.assertTrue(regexes[1].optimized)
+        self.assertTrue(regexes[0].match('ABC'))
+
+    def test_twin_keeps_locale(self):
+        regex = RegexObject(r'(\w)(\w)', locale='C')
+        self.assertTrue(regex.test('ab'))
+        self.assertTrue(regex.twin_size > 0)
+
+    def test_latin1_caseless(self):
+        if LATIN1 is None:
+            self.skipTest('no Latin-1 locale is installed')
+        self.assertFalse(RegexObject(r'\xc4', pcre.IGNORECASE).test('\xe4'))
+        self.assertTrue(RegexObject(r'\xc4', pcre.IGNORECASE, locale=LATIN1).test('\xe4'))
+        self.assertTrue(RegexObject(r'^\w$', locale=LATIN1).test('\xe4'))
+
+if __name__ == '__main__':
+    unittest.main()
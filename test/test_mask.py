@@ -0,0 +1,75 @@
+import mmap
+import threading
+import unittest
+import pcre
+
+class TestMask(unittest.TestCase):
+    def setUp(self):
+        self.regex = pcre.compile(r'\d')
+
+    def test_bytearray(self):
+        buf = bytearray('card 4111-1111, pin 12')
+        self.assertEquals(10, self.regex.mask(buf))
+        self.assertEquals('card ****-****, pin **', str(buf))
+
+    def test_fill_byte(self):
+        buf = bytearray('a1b22')
+        self.regex.mask(buf, 'x')
+        self.assertEquals('axbxx', str(buf))
+
+    def test_groups(self):
+        regex = pcre.compile(r'(?<user>\w+)@(?<domain>[\w.]+)')
+        buf = bytearray('mail john@example.com now')
+        self.assertEquals(1, regex.mask(buf, '#', ('user',)))
+        self.assertEquals('mail ####@example.com now', str(buf))
+
+    def test_same_length_fill(self):
+        regex = pcre.compile(r'\d{4}-\d{2}-\d{2}')
+        buf = bytearray('born 1999-01-31, died 2060-12-01')
+        self.assertEquals(2, regex.mask(buf, 'YYYY-MM-DD'))
+        self.assertEquals('born YYYY-MM-DD, died YYYY-MM-DD', str(buf))
+
+    def test_different_length_fill(self):
+        self.assertRaises(ValueError, self.regex.mask, bytearray('12'), 'ab')
+        buf = bytearray('pin 1234, 56')
+        self.assertRaises(ValueError, pcre.compile(r'\d+').mask, buf, 'XXXX')
+        self.assertEquals('pin 1234, 56', str(buf))
+
+    def test_mmap(self):
+        buf = mmap.mmap(-1, 8)
+        buf[:] = 'id 12345'
+        self.assertEquals(5, self.regex.mask(buf))
+        self.assertEquals('id *****', buf[:])
+        buf.close()
+
+    def test_mmap_closed_by_thread(self):
+        regex = pcre.compile(r'\d+')
+        for i in range(20):
+            buf = mmap.mmap(-1, 1 << 20)
+            buf[:] = '12 ' * (1 << 18) + '12345678' * (1 << 15)
+            closer = threading.Thread(target=buf.close)
+            closer.start()
+            try:
+                regex.mask(buf)
+            except (TypeError, ValueError):
+                pass # closed before the call
+            closer.join()
+
+    def test_readonly(self):
+        self.assertRaises((TypeError, BufferError), self.regex.mask, 'id 12345')
+
+    def test_jit_threads(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        regex = pcre._pcre.RegexObject(r'\d+', 0, 1, 1)
+        buffers = [bytearray('call 555-0100 ' * 1000) for i in range(4)]
+        threads = [threading.Thread(target=regex.mask, args=(buf,)) for buf in buffers]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for buf in buffers:
+            self.assertEquals('call ***-**** ' * 1000, str(buf))
+
+if __name__ == '__main__':
+    unittest.main()
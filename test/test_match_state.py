@@ -0,0 +1,67 @@
+import gc
+import unittest
+import pcre
+
+class TestMatchState(unittest.TestCase):
+    def setUp(self):
+        self.regex = pcre.compile(r'(?<key>\w+)=(\d+)?(x)?')
+        self.state = pcre._pcre.MatchState(self.regex)
+
+    def test_match(self):
+        self.assertTrue(self.regex.match_into(self.state, 'a key=42;'))
+        self.assertTrue(self.state.matched)
+        self.assertEquals('key=42', self.state.group())
+        self.assertEquals('key', self.state.group(1))
+        self.assertEquals('key', self.state.group('key'))
+        self.assertEquals('42', self.state.group(2))
+        self.assertEquals(None, self.state.group(3))
+
+    def test_offsets(self):
+        self.regex.match_into(self.state, 'a key=42;')
+        self.assertEquals(2, self.state.start())
+        self.assertEquals(8, self.state.end())
+        self.assertEquals((6, 8), self.state.span(2))
+        self.assertEquals((-1, -1), self.state.span(3))
+        self.assertEquals(-1, self.state.start(3))
+
+    def test_overwrite(self):
+        self.assertTrue(self.regex.match_into(self.state, 'a=1'))
+        self.assertTrue(self.regex.match_into(self.state, 'bb='))
+        self.assertEquals('bb', self.state.group(1))
+        self.assertEquals(None, self.state.group(2))
+        self.assertEquals('bb=', self.state.string)
+
+    def test_nomatch(self):
+        self.assertFalse(self.regex.match_into(self.state, 'nothing'))
+        self.assertFalse(self.state.matched)
+        self.assertRaises(pcre.error, self.state.group)
+
+    def test_pos_endpos(self):
+        self.assertTrue(self.regex.match_into(self.state, 'a=1 b=2', 2))
+        self.assertEquals('b=2', self.state.group())
+        self.assertTrue(self.regex.match_into(self.state, 'a=123', 0, 3))
+        self.assertEquals('a=1', self.state.group())
+        self.assertFalse(self.regex.match_into(self.state, 'a=1', 5))
+
+    def test_no_such_group(self):
+        self.regex.match_into(self.state, 'a=1')
+        self.assertRaises(IndexError, self.state.group, 4)
+        self.assertRaises(IndexError, self.state.group, 'missing')
+
+    def test_other_pattern(self):
+        other = pcre._pcre.RegexObject(r'(\w+)=')
+        self.assertRaises(ValueError, other.match_into, self.state, 'a=1')
+
+    def test_no_allocations(self):
+        # live objects don't grow with the number of calls
+        subject = 'key=1'
+        match_into, state = self.regex.match_into, self.state
+        counts = []
+        for calls in (10, 10000):
+            for i in xrange(calls):
+                match_into(state, subject)
+            counts.append(len(gc.get_objects()))
+        self.assertEquals(counts[0], counts[1])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,57 @@
+import os
+import unittest
+import pcre
+
+class TestPerfMap(unittest.TestCase):
+    def setUp(self):
+        self.path = pcre._pcre.perf_map(True)
+
+    def tearDown(self):
+        pcre._pcre.perf_map(False)
+        os.remove(self.path)
+
+    def entries(self):
+        with open(self.path) as f:
+            return [line.rstrip('\n').split(' ', 2) for line in f]
+
+    def executable(self, address):
+        with open('/proc/self/maps') as f:
+            for line in f:
+                fields = line.split()
+                start, end = [int(x, 16) for x in fields[0].split('-')]
+                if start <= address < end:
+                    return 'x' in fields[1]
+        return False
+
+    def test_path(self):
+        self.assertEquals('/tmp/perf-%d.map' % os.getpid(), self.path)
+
+    def test_jit_pattern(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        regex = pcre._pcre.RegexObject(r'perf(\d+)map', 0, 1, 1)
+        entries = [e for e in self.entries() if e[2] == r'pcre:perf(\d+)map']
+        self.assertEquals(1, len(entries))
+        start, size = int(entries[0][0], 16), int(entries[0][1], 16)
+        self.assertEquals(regex.jit_size, size)
+        self.assertTrue(self.executable(start))
+
+    def test_interpreted_pattern(self):
+        pcre._pcre.RegexObject(r'plain\d+')
+        self.assertEquals([], [e for e in self.entries() if e[2] == r'pcre:plain\d+'])
+
+    def test_line_break(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        pcre._pcre.RegexObject('first\nsecond', 0, 1, 1)
+        self.assertEquals(1, len([e for e in self.entries() if e[2] == 'pcre:first']))
+
+    def test_disabled(self):
+        pcre._pcre.perf_map(False)
+        if pcre._pcre.jit_enabled():
+            pcre._pcre.RegexObject(r'hidden', 0, 1, 1)
+        self.path = pcre._pcre.perf_map(True)
+        self.assertEquals([], [e for e in self.entries() if e[2] == 'pcre:hidden'])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,39 @@
+import unittest
+import pcre
+
+class TestProfile(unittest.TestCase):
+    def setUp(self):
+        self.regex = pcre.compile(r'(a+)+b')
+
+    def test_empty_corpus(self):
+        self.assertEquals([], self.regex.profile([]))
+
+    def test_offsets(self):
+        profile = self.regex.profile(['aab'])
+        offsets = [offset for offset, visits, backtracks in profile]
+        self.assertEquals(sorted(offsets), offsets)
+        for offset in offsets:
+            self.assertTrue(0 <= offset <= len(self.regex.pattern))
+
+    def test_backtracking(self):
+        profile = self.regex.profile(['aaaaaaacb'])
+        visits = sum(v for o, v, b in profile)
+        backtracks = sum(b for o, v, b in profile)
+        self.assertTrue(visits > 100)
+        self.assertTrue(backtracks > 0)
+
+    def test_invalid_subject(self):
+        self.assertRaises(TypeError, self.regex.profile, [1])
+
+    def test_callout_of_other_pattern(self):
+        # the corpus runs Python code, which matches another pattern with callouts
+        other = pcre._pcre.RegexObject(r'x(?C1)y')
+        def corpus():
+            for subject in ('aab', 'ab'):
+                self.assertTrue(other.test('xy'))
+                yield subject
+        self.assertTrue(self.regex.profile(corpus()))
+        self.assertTrue(other.test('xy'))
+
+if __name__ == '__main__':
+    unittest.main()
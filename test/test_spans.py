@@ -0,0 +1,53 @@
+import array
+import unittest
+import pcre
+
+class TestSpans(unittest.TestCase):
+    def setUp(self):
+        self.regex = pcre.compile(r'(?<scheme>https?)://(?<host>[a-z.]+)(:\d+)?')
+        self.text = 'see http://a.com and https://b.org:8080 or http://c.net'
+
+    def test_spans(self):
+        spans = self.regex.spans(self.text)
+        self.assertEquals('i', spans.typecode)
+        self.assertEquals(6, len(spans))
+        self.assertEquals('http://a.com', self.text[spans[0]:spans[1]])
+        self.assertEquals('https://b.org:8080', self.text[spans[2]:spans[3]])
+
+    def test_groups(self):
+        spans = self.regex.spans(self.text, groups=('host', 3))
+        self.assertEquals('a.com', self.text[spans[0]:spans[1]])
+        self.assertEquals([-1, -1], spans[2:4].tolist())
+        self.assertEquals(':8080', self.text[spans[6]:spans[7]])
+
+    def test_invalid_group(self):
+        self.assertRaises(IndexError, self.regex.spans, self.text, 0, (4,))
+        self.assertRaises(IndexError, self.regex.spans, self.text, 0, ('port',))
+
+    def test_empty_matches(self):
+        self.assertEquals([0, 0, 1, 1, 2, 2], pcre.compile(r'x*').spans('ab').tolist())
+
+    def test_many(self):
+        spans = pcre.compile(r'\d').spans('1' * 1000)
+        self.assertEquals(2000, len(spans))
+
+    def test_spans_into(self):
+        buf = array.array('i', [0] * 4)
+        matches, pos = self.regex.spans_into(buf, self.text)
+        self.assertEquals(2, matches)
+        self.assertEquals('https://b.org:8080', self.text[buf[2]:buf[3]])
+        matches, pos = self.regex.spans_into(buf, self.text, pos)
+        self.assertEquals(1, matches)
+        self.assertEquals(-1, pos)
+        self.assertEquals('http://c.net', self.text[buf[0]:buf[1]])
+
+    def test_spans_into_small_buffer(self):
+        self.assertRaises(ValueError, pcre.compile(r'a').spans_into, bytearray(3), 'aaa')
+        self.assertRaises(ValueError, self.regex.spans_into, array.array('i', [0] * 4), self.text, 0, ())
+        self.assertEquals((1, 1), pcre.compile(r'a').spans_into(bytearray(8), 'aaa'))
+
+    def test_spans_into_readonly(self):
+        self.assertRaises(TypeError, self.regex.spans_into, 'abcdefgh', self.text)
+
+if __name__ == '__main__':
+    unittest.main()
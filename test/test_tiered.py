@@ -0,0 +1,80 @@
+import unittest
+import pcre
+
+RegexObject = pcre._pcre.RegexObject
+
+class TestTiered(unittest.TestCase):
+    def setUp(self):
+        self.thresholds = pcre._pcre.adaptive_thresholds()
+        pcre._pcre.adaptive_thresholds(study_calls=3, study_bytes=1 << 30, jit_calls=6, jit_bytes=1 << 30)
+
+    def tearDown(self):
+        pcre._pcre.adaptive_thresholds(**self.thresholds)
+
+    def test_static_tiers(self):
+        self.assertEquals(0, RegexObject(r'a+').tier)
+        self.assertEquals(1, RegexObject(r'a+', 0, 1).tier)
+        self.assertFalse(RegexObject(r'a+').adaptive)
+
+    def test_not_adaptive(self):
+        regex = RegexObject(r'a+')
+        for i in range(10):
+            regex.match('aaa')
+        self.assertEquals(10, regex.exec_calls)
+        self.assertEquals(0, regex.tier)
+
+    def test_promotion_by_calls(self):
+        regex = RegexObject(r'(\w+)@(\w+)', adaptive=1)
+        self.assertEquals(0, regex.tier)
+        for i in range(2):
+            regex.match('user@host')
+        self.assertEquals(0, regex.tier)
+        regex.match('user@host')
+        self.assertEquals(1, regex.tier)
+        for i in range(3):
+            regex.match('user@host')
+        self.assertEquals(2 if pcre._pcre.jit_enabled() else 1, regex.tier)
+        self.assertEquals(pcre._pcre.jit_enabled(), regex.jit_compiled)
+        self.assertEquals('host', regex.match('user@host').group(2))
+
+    def test_promotion_by_bytes(self):
+        pcre._pcre.adaptive_thresholds(study_calls=1 << 20, study_bytes=100, jit_calls=1 << 20, jit_bytes=100)
+        regex = RegexObject(r'\d+', adaptive=1)
+        regex.test('x' * 98 + '1')
+        self.assertEquals(0, regex.tier)
+        self.assertEquals(99, regex.exec_bytes)
+        regex.test('1')
+        self.assertEquals(2 if pcre._pcre.jit_enabled() else 1, regex.tier)
+
+    def test_twin_counts_to_owner(self):
+        regex = RegexObject(r'(\d+)-(\d+)', adaptive=1)
+        for i in range(4):
+            self.assertTrue(regex.test('1-2'))
+        self.assertEquals(4, regex.exec_calls)
+        self.assertEquals(1, regex.tier)
+        self.assertEquals(2, regex.count('1-2 3-4'))
+
+    def test_mask(self):
+        regex = RegexObject(r'\d', adaptive=1)
+        buf = bytearray('a1b2c3d4')
+        self.assertEquals(4, regex.mask(buf))
+        self.assertEquals('a*b*c*d*', str(buf))
+        self.assertEquals(1, regex.tier)
+
+    def test_memory_usage(self):
+        if not pcre._pcre.jit_enabled():
+            self.skipTest('libpcre is compiled without JIT support')
+        regex = RegexObject(r'[a-z]+\d', adaptive=1)
+        before = pcre._pcre.memory_usage()
+        for i in range(7):
+            regex.match('abc1')
+        after = pcre._pcre.memory_usage()
+        self.assertEquals(before['jit_patterns'] + 1, after['jit_patterns'])
+        self.assertEquals(before['patterns'], after['patterns'])
+        self.assertEquals(before['jit_code'] + regex.jit_size, after['jit_code'])
+
+    def test_invalid_thresholds(self):
+        self.assertRaises(ValueError, pcre._pcre.adaptive_thresholds, jit_calls=-1)
+
+if __name__ == '__main__':
+    unittest.main()
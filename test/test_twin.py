@@ -0,0 +1,47 @@
+import array
+import unittest
+import pcre
+
+class TestTwin(unittest.TestCase):
+    def setUp(self):
+        self.regex = pcre._pcre.RegexObject(r'(\d+)-(\d+)-(?<day>\d+)')
+
+    def test_no_twin_before_use(self):
+        self.assertEquals(0, self.regex.twin_size)
+
+    def test_test(self):
+        self.assertTrue(self.regex.test('on 2012-01-31'))
+        self.assertFalse(self.regex.test('on 2012/01/31'))
+        self.assertTrue(self.regex.twin_size > 0)
+
+    def test_count(self):
+        self.assertEquals(2, self.regex.count('1-2-3 and 4-5-6, 7-8'))
+        self.assertEquals(3, pcre.compile(r'x*').count('ab'))
+
+    def test_spans(self):
+        text = 'a 1-2-3 b 44-55-66'
+        self.assertEquals([2, 7, 10, 18], self.regex.spans(text).tolist())
+        self.assertTrue(self.regex.twin_size > 0)
+
+    def test_backreference(self):
+        regex = pcre.compile(r'(a)(b)\2')
+        self.assertTrue(regex.test('xabb'))
+        self.assertFalse(regex.test('xaba'))
+        self.assertEquals(0, regex.twin_size)
+
+    def test_subroutine_call(self):
+        regex = pcre.compile(r'(a)(?<n>b)(?1)')
+        self.assertTrue(regex.test('aba'))
+        self.assertFalse(regex.test('abb'))
+        self.assertEquals(0, regex.twin_size)
+
+    def test_memory_usage(self):
+        regex = pcre.compile(r'(x)(y)')
+        before = pcre._pcre.memory_usage()
+        regex.test('xy')
+        after = pcre._pcre.memory_usage()
+        self.assertEquals(before['twins'] + 1, after['twins'])
+        self.assertEquals(before['twin'] + regex.twin_size, after['twin'])
+
+if __name__ == '__main__':
+    unittest.main()